@@ -1,9 +1,9 @@
 # run with rspec spec db.test.rb
 
 # opens the binary, executes the commands and returns the stdout
-def run_script(commands)
+def run_script(commands, options = [], filename = '../bin/dbfile')
   raw_output = nil
-  IO.popen(['../bin/db', '../bin/dbfile'], 'r+') do |pipe|
+  IO.popen(['../bin/db', *options, filename], 'r+') do |pipe|
     commands.each do |command|
       pipe.puts command
     rescue Errno::EPIPE
@@ -16,12 +16,23 @@ def run_script(commands)
   raw_output.split("\n")
 end
 
+# writes the CRC32C of a page at its end, as the pager does
+def seal_page(file, page_num)
+  file.seek(page_num * 4096)
+  crc = 0xFFFFFFFF
+  file.read(4092).each_byte do |byte|
+    crc ^= byte
+    8.times { crc = crc.odd? ? (crc >> 1) ^ 0x82F63B78 : crc >> 1 }
+  end
+  file.write([crc ^ 0xFFFFFFFF].pack('V'))
+end
+
 describe('database') do
   before :each do
-    File.delete('../bin/dbfile') if File.exist?('../bin/dbfile')
+    ['../bin/dbfile', '../bin/dbfile-warm'].each { |file| File.delete(file) if File.exist?(file) }
   end
   after :all do
-    File.delete('../bin/dbfile') if File.exist?('../bin/dbfile')
+    ['../bin/dbfile', '../bin/dbfile-warm'].each { |file| File.delete(file) if File.exist?(file) }
   end
 
   it('inserts and retrieves a row') do
@@ -38,7 +49,7 @@ describe('database') do
                                   ])
   end
 
-  it('prints error message when table is full') do
+  it('keeps inserting once the table is bigger than the buffer pool') do
     script = (1..1401).map do |i|
       "insert #{i} user#{i} person#{i}@example.com"
     end
@@ -46,8 +57,43 @@ describe('database') do
     result = run_script(script)
     expect(result.last(2)).to match_array([
                                             'db > Executed.',
-                                            'db > Need to implement updating parent after split'
+                                            'db > '
                                           ])
+
+    result = run_script(['select', '.exit'])
+    expect(result.length).to eq(1403)
+    expect(result[700]).to eq('(701, user701, person701@example.com)')
+  end
+
+  it('stores compressed pages when created with --compress') do
+    script = (1..1401).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script << '.exit'
+    run_script(script, ['--compress'])
+    expect(File.size('../bin/dbfile')).to be < 100 * 1024
+
+    result = run_script(['insert 1402 user1402 person1402@example.com', 'select', '.exit'])
+    expect(result.length).to eq(1405)
+    expect(result[701]).to eq('(701, user701, person701@example.com)')
+    expect(result[1402]).to eq('(1402, user1402, person1402@example.com)')
+  end
+
+  it('keeps a compressed file as it was closed when the process dies') do
+    script = (1..2000).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    run_script(script + ['.exit'], ['--compress'])
+    IO.popen(['../bin/db', '../bin/dbfile'], 'r+') do |pipe|
+      (2001..4000).each { |i| pipe.puts "insert #{i} user#{i} person#{i}@example.com" }
+      # the output is buffered, rows far from the end of the select mean the inserts are done
+      pipe.puts 'select'
+      nil until pipe.gets.include?('(3000, user3000')
+      Process.kill('KILL', pipe.pid)
+    end
+    result = run_script(['select where id = 2000', 'select where id = 2001', '.check', '.exit'])
+    expect(result).to eq(['db > (2000, user2000, person2000@example.com)', 'Executed.', 'db > Executed.',
+                          'db > Checked 287 pages in 2 trees: ok.', 'db > '])
   end
 
   it('allows inserting strings that are the maximum length') do
@@ -83,18 +129,22 @@ describe('database') do
                                   ]))
   end
 
-  it('prints an error message if id is negative') do
+  it('orders negative ids before positive ones') do
     script = [
+      'insert 2 user2 person2@example.com',
       'insert -1 cstack foo@bar.com',
       'select',
       '.exit'
     ]
     result = run_script(script)
-    expect(result).to(match_array([
-                                    'db > ID must be positive.',
-                                    'db > Executed.',
-                                    'db > '
-                                  ]))
+    expect(result).to(eq([
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > (-1, cstack, foo@bar.com)',
+                           '(2, user2, person2@example.com)',
+                           'Executed.',
+                           'db > '
+                         ]))
   end
 
   it('keeps data after closing connection') do
@@ -125,11 +175,11 @@ describe('database') do
     result = run_script(script)
     expect(result).to(match_array([
                                     'db > Constants:',
-                                    'ROW_SIZE: 293',
+                                    'ROW_SIZE: 295',
                                     'COMMON_NODE_HEADER_SIZE: 6',
                                     'LEAF_NODE_HEADER_SIZE: 14',
-                                    'LEAF_NODE_CELL_SIZE: 297',
-                                    'LEAF_NODE_SPACE_FOR_CELLS: 4082',
+                                    'LEAF_NODE_CELL_SIZE: 299',
+                                    'LEAF_NODE_SPACE_FOR_CELLS: 4078',
                                     'LEAF_NODE_MAX_CELLS: 13',
                                     'db > '
                                   ]))
@@ -202,4 +252,506 @@ describe('database') do
                                                           'db > '
                                                         ])
   end
+
+  it('finds rows through an index on email') do
+    script = (1..30).map do |i|
+      "insert #{i} user#{i} person#{i % 10}@example.com"
+    end
+    script << 'create index on email'
+    script << 'select where email = person3@example.com'
+    script << 'insert 31 user31 person3@example.com'
+    script << 'select where email = person3@example.com'
+    script << 'create index on email'
+    script << '.exit'
+    result = run_script(script)
+
+    expect(result[30...(result.length)]).to match_array([
+                                                          'db > Executed.',
+                                                          'db > (3, user3, person3@example.com)',
+                                                          '(13, user13, person3@example.com)',
+                                                          '(23, user23, person3@example.com)',
+                                                          'Executed.',
+                                                          'db > Executed.',
+                                                          'db > (3, user3, person3@example.com)',
+                                                          '(13, user13, person3@example.com)',
+                                                          '(23, user23, person3@example.com)',
+                                                          '(31, user31, person3@example.com)',
+                                                          'Executed.',
+                                                          'db > Error: Index already exists.',
+                                                          'db > '
+                                                        ])
+  end
+
+  it('keeps the index after closing connection and uses it for prefixes') do
+    run_script([
+                 'create index on username',
+                 'insert 1 alice a@example.com',
+                 'insert 2 bob b@example.com',
+                 'insert 3 alicia c@example.com',
+                 '.exit'
+               ])
+    result = run_script([
+                          'select where username like ali%',
+                          'select where id = 2',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > (1, alice, a@example.com)',
+                                    '(3, alicia, c@example.com)',
+                                    'Executed.',
+                                    'db > (2, bob, b@example.com)',
+                                    'Executed.',
+                                    'db > '
+                                  ])
+  end
+
+  it('answers from an index that includes the projected columns') do
+    result = run_script([
+                          'insert 1 alice a@example.com',
+                          'insert 2 bob b@example.com',
+                          'insert 3 carol a@example.com',
+                          'create index on email include username',
+                          'select id, username where email = a@example.com',
+                          'select username, email where email like b%',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > (1, alice)',
+                                    '(3, carol)',
+                                    'Executed.',
+                                    'db > (bob, b@example.com)',
+                                    'Executed.',
+                                    'db > '
+                                  ])
+  end
+
+  it('looks up ids through a hash index') do
+    script = ['create hash index on id']
+    script += (1..40).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script << 'select where id = 27'
+    script << 'select where id = 41'
+    script << 'create hash index on email'
+    script << '.exit'
+    result = run_script(script)
+
+    expect(result[41...(result.length)]).to match_array([
+                                                          'db > (27, user27, person27@example.com)',
+                                                          'Executed.',
+                                                          'db > Executed.',
+                                                          'db > Syntax error. Could not parse statement create ',
+                                                          'db > '
+                                                        ])
+  end
+
+  it('creates tables registered in the catalog') do
+    result = run_script([
+                          'create table accounts',
+                          'create table accounts',
+                          'insert into accounts 1 alice alice@example.com',
+                          'insert 2 bob bob@example.com',
+                          'select from accounts',
+                          'select username from users where id = 2',
+                          'select from missing',
+                          '.tables',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > Executed.',
+                                    'db > Error: Table already exists.',
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > (1, alice, alice@example.com)',
+                                    'Executed.',
+                                    'db > (bob)',
+                                    'Executed.',
+                                    'db > Error: No such table.',
+                                    'db > accounts',
+                                    'users',
+                                    'db > '
+                                  ])
+
+    result = run_script([
+                          'create index on accounts.email',
+                          '.exit'
+                        ])
+    expect(result).to match_array(['db > Executed.', 'db > '])
+
+    result = run_script([
+                          'select id from accounts where email = alice@example.com',
+                          'select from users',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > (1)',
+                                    'Executed.',
+                                    'db > (2, bob, bob@example.com)',
+                                    'Executed.',
+                                    'db > '
+                                  ])
+  end
+
+  it('stores the typed columns of a table schema') do
+    result = run_script([
+                          'create table events (id int32, at int64, score double, tag text(8), payload blob(4))',
+                          'insert into events 1 -9000000000 2.5 start 00ff',
+                          'insert into events 2 7 -0.125 end cafe',
+                          'insert into events 3 x 1 a 00',
+                          'insert into events 3 1 1 toolongtag 00',
+                          'create index on events.tag include score',
+                          'select tag, score from events where tag = end',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > Executed.',
+                                    'db > Syntax error. Could not parse statement insert ',
+                                    'db > String is too long.',
+                                    'db > Executed.',
+                                    'db > (end, -0.125)',
+                                    'Executed.',
+                                    'db > '
+                                  ])
+
+    result = run_script([
+                          'select from events where payload = 00ff',
+                          'create table huge (id int32, a text(1000), b text(1000))',
+                          '.exit'
+                        ])
+    expect(result).to match_array([
+                                    'db > (1, -9000000000, 2.5, start, 00ff)',
+                                    'Executed.',
+                                    'db > Record is too large.',
+                                    'db > '
+                                  ])
+  end
+
+  it('orders 64-bit and composite primary keys') do
+    result = run_script([
+                          'create table visits (tenant int64, page text(16), hits int32, primary key (tenant, page))',
+                          'insert into visits 3000000000 home 1',
+                          'insert into visits -5 home 2',
+                          'insert into visits 3000000000 about 3',
+                          'insert into visits 3000000000 about 4',
+                          'create hash index on visits.tenant',
+                          'select from visits',
+                          '.btree visits',
+                          '.exit'
+                        ])
+    expect(result).to eq([
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Error: Duplicate key.',
+                           'db > Syntax error. Could not parse statement create ',
+                           'db > (-5, home, 2)',
+                           '(3000000000, about, 3)',
+                           '(3000000000, home, 1)',
+                           'Executed.',
+                           'db > Tree:',
+                           '- leaf (size 3)',
+                           '  - -5, home',
+                           '  - 3000000000, about',
+                           '  - 3000000000, home',
+                           'db > '
+                         ])
+  end
+
+  it('packs the rows of an encoded table in its leaves') do
+    script = ['create encoded table archive']
+    script += (1..100).map do |i|
+      "insert into archive #{i} user#{i % 10} person#{i}@example.com"
+    end
+    script += ['.btree archive', 'select from archive where username = user3', '.exit']
+    result = run_script(script)
+    expect(result[102]).to eq('- leaf (size 100)')
+    expect(result.last(12)).to eq(['db > (3, user3, person3@example.com)'] +
+                                  (1..9).map { |i| "(#{i * 10 + 3}, user3, person#{i * 10 + 3}@example.com)" } +
+                                  ['Executed.', 'db > '])
+
+    result = run_script(['insert into archive 101 user1 person101@example.com', 'select from archive', '.exit'])
+    expect(result.length).to eq(104)
+    expect(result[1]).to eq('db > (1, user1, person1@example.com)')
+    expect(result[101]).to eq('(101, user1, person101@example.com)')
+  end
+
+  it('reads only the projected columns of a columnar table') do
+    script = ['create columnar table archive']
+    script += (1..20).map do |i|
+      "insert into archive #{i} user#{i % 4} person#{i}@example.com"
+    end
+    script += ['.btree archive', 'select id from archive where username = user3', '.exit']
+    result = run_script(script)
+    expect(result[21..23]).to eq(['db > Tree:', '- internal (size 1)', '  - leaf (size 7)'])
+    expect(result.last(7)).to eq(['db > (3)', '(7)', '(11)', '(15)', '(19)', 'Executed.', 'db > '])
+
+    result = run_script(['select from archive where id = 18', '.exit'])
+    expect(result).to eq(['db > (18, user2, person18@example.com)', 'Executed.', 'db > '])
+  end
+
+  it('prints the pager and tree counters') do
+    script = (1..40).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['.stats', '.stats nope', '.exit']
+    result = run_script(script)
+    expect(result).to include('db > Buffer pool:', 'File (posix):', '  syncs: 0')
+    expect(result.last(9)).to eq(['Tree users:',
+                                  '  height: 2',
+                                  '  level 0: 1 nodes',
+                                  '  level 1: 5 nodes',
+                                  '  leaf splits: 4',
+                                  '  internal splits: 0',
+                                  '  leaf fill: 58.8%',
+                                  "db > No such table 'nope'.",
+                                  'db > '])
+  end
+
+  it('stores the file through the chosen vfs') do
+    script = (1..40).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    run_script(script + ['.exit'], ['--vfs', 'mmap'])
+    result = run_script(['select where id = 40', '.stats', '.exit'], ['--vfs', 'mmap', '--io-latency', '10'])
+    expect(result).to include('db > (40, user40, person40@example.com)', 'File (latency(mmap)):')
+    expect(File.size('../bin/dbfile')).to eq(8 * 4096)
+
+    # the memory vfs leaves nothing behind
+    File.delete('../bin/dbfile')
+    result = run_script(script + ['select where id = 40', '.exit'], ['--vfs', 'memory'])
+    expect(result.last(3)).to eq(['db > (40, user40, person40@example.com)', 'Executed.', 'db > '])
+    expect(File.exist?('../bin/dbfile')).to eq(false)
+    expect(run_script([], ['--vfs', 'nope'])).to eq(["Unknown VFS 'nope'."])
+  end
+
+  it('keeps a :memory: database in the buffer pool only') do
+    script = (1..1500).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['select where id = 1500', '.stats', '.check', '.exit']
+    result = run_script(script, [], ':memory:')
+    expect(result).to include('db > (1500, user1500, person1500@example.com)', '  evictions: 0',
+                              'File: none, the database is in memory.')
+    expect(result.find { |line| line.start_with?('  pages: ') }).to eq('  pages: 217 in memory, no capacity')
+    expect(result[-2]).to match(/^db > Checked [0-9]+ pages in 2 trees: ok\.$/)
+    expect(File.exist?(':memory:')).to eq(false)
+  end
+
+  it('keeps the pages of point lookups in the pool during a full scan') do
+    script = (1..1500).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    run_script(script + ['.exit'])
+    File.delete('../bin/dbfile-warm')
+    result = run_script([
+                          'select where id = 1',
+                          'select from users where username = nobody',
+                          'explain analyze select where id = 1',
+                          '.stats',
+                          '.exit'
+                        ])
+    expect(result[4]).to match(/^  - primary key on users where id = 1 \(rows 1, pages [0-9]+, misses 0, time/)
+    expect(result).to include('  evictions: 197', '  pages: 20 in memory (16 in the scan ring), 0 dirty, capacity 100')
+  end
+
+  it('warms the buffer pool up with the pages that were hot at close') do
+    script = (1..1500).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    run_script(script + ['.exit'])
+    expect(File.size('../bin/dbfile-warm')).to eq(102 * 4)
+    result = run_script(['explain analyze select where id = 1500', '.stats', '.exit'])
+    expect(result[1]).to match(/^  - primary key on users where id = 1500 \(rows 1, pages [0-9]+, misses 0, time/)
+    expect(result).to include('  warmed up: 100')
+
+    # a damaged list is ignored
+    File.open('../bin/dbfile-warm', 'r+b') { |file| file.write([7].pack('V')) }
+    result = run_script(['.stats', '.exit'])
+    expect(result).to include('  warmed up: 0')
+  end
+
+  it('finds rows through the children swizzled in their parent while pages come and go') do
+    ids = (1..1500).to_a.shuffle(random: Random.new(42))
+    script = ids.map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['select from users where username = nobody']
+    script += [1, 750, 1500, 1501].map { |i| "select where id = #{i}" }
+    script += ['.check', '.exit']
+    result = run_script(script)
+    expect(result.last(9)[0..6]).to eq(['db > (1, user1, person1@example.com)', 'Executed.',
+                                        'db > (750, user750, person750@example.com)', 'Executed.',
+                                        'db > (1500, user1500, person1500@example.com)', 'Executed.',
+                                        'db > Executed.'])
+    expect(result[-2]).to match(/^db > Checked [0-9]+ pages in 2 trees: ok\.$/)
+  end
+
+  it('explains and analyzes the plan of a statement') do
+    script = (1..20).map do |i|
+      "insert #{i} user#{i % 4} person#{i}@example.com"
+    end
+    script += [
+      'explain select id from users where username = user3',
+      'explain analyze select id from users where username = user3',
+      'create index on username',
+      'explain select from users where username like user1%',
+      'explain analyze insert 21 user1 person21@example.com',
+      '.exit'
+    ]
+    result = run_script(script)
+    expect(result[20..23]).to eq(['db > - project id', '  - filter username = user3', '    - full scan on users',
+                                  'Executed.'])
+    expect(result[24]).to match(/^db > - project id \(rows 5, time [0-9.]+ us\)$/)
+    expect(result[25]).to match(/^  - filter username = user3 \(rows 5, time [0-9.]+ us\)$/)
+    expect(result[26]).to match(/^    - full scan on users \(rows 20, pages \d+, misses 0, time [0-9.]+ us\)$/)
+    expect(result[28..30]).to eq(['db > Executed.',
+                                  'db > - project id, username, email',
+                                  '  - index scan on users by index on username where username like user1%'])
+    expect(result[32]).to match(/^db > - insert into users \(rows 1, pages \d+, misses \d+, leaf splits \d+, time [0-9.]+ us\)$/)
+    expect(result.last(3)).to eq(['  - update index on username', 'Executed.', 'db > '])
+  end
+
+  it('checks the integrity of the btrees') do
+    script = (1..20).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['create index on username', '.check', '.check users', '.exit']
+    result = run_script(script)
+    expect(result.last(3)).to eq(['db > Checked 5 pages in 3 trees: ok.',
+                                  'db > Checked 4 pages in 2 trees: ok.',
+                                  'db > '])
+
+    # the left leaf of users (page 4) loses its sibling, the right one (page 3) gets a key of the left one
+    File.open('../bin/dbfile', 'r+b') do |file|
+      file.seek(4 * 4096 + 10)
+      file.write([0].pack('V'))
+      file.seek(3 * 4096 + 14)
+      file.write([0x80, 0, 0, 1].pack('C*'))
+      seal_page(file, 3)
+      seal_page(file, 4)
+    end
+    result = run_script(['.check users', '.exit'])
+    expect(result).to eq(['db > users, page 3: the previous leaf links to page 0 instead',
+                          'users, page 3: key of cell 0 is not greater than the previous one',
+                          'users, page 3: key of cell 0 belongs on the left of the separator above',
+                          'Checked 4 pages in 2 trees: 3 problems.',
+                          'db > '])
+  end
+
+  it('checks an index tree whose keys are longer than a table key') do
+    script = (1..30).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['create index on email', '.check']
+    script += (31..60).map do |i|
+      "insert #{i} user#{i} person#{i}@example.com"
+    end
+    script += ['.check', '.exit']
+    result = run_script(script)
+    expect(result.select { |line| line.include?('Checked') }).to eq(['db > Checked 14 pages in 3 trees: ok.',
+                                                                     'db > Checked 25 pages in 3 trees: ok.'])
+  end
+
+  it('stops at a page that does not match its checksum') do
+    run_script(['insert 1 user1 person1@example.com', '.exit'])
+    File.open('../bin/dbfile', 'r+b') do |file|
+      file.seek(2 * 4096 + 20)
+      file.write('x')
+    end
+    result = run_script(['select', '.exit'])
+    expect(result).to eq(['db > Page 2 is corrupt: bad checksum.'])
+  end
+
+  it('does not take a written page that was zeroed for one that was never written') do
+    run_script(['insert 1 user1 person1@example.com', '.exit'])
+    File.open('../bin/dbfile', 'r+b') do |file|
+      file.seek(2 * 4096)
+      file.write("\0" * 4096)
+    end
+    result = run_script(['select', '.exit'])
+    expect(result).to eq(['db > Page 2 is corrupt: bad checksum.'])
+  end
+
+  it('needs the tracepoints compiled in to trace') do
+    result = run_script(['.trace', '.trace bin/trace.json', '.exit'])
+    expect(result).to eq(['db > Tracing is not compiled in, rebuild with make TRACE=1.'] * 2 + ['db > '])
+  end
+
+  it('keeps latency histograms and logs the slow statements') do
+    result = run_script([
+                          'insert 1 user1 person1@example.com',
+                          'insert 2 user2 person2@example.com',
+                          '.slowlog 0',
+                          'select from users where id = 2',
+                          '.slowlog 60000000',
+                          'select from users',
+                          '.slowlog',
+                          '.latency',
+                          '.exit'
+                        ])
+    expect(result[7]).to match(/^db > [0-9.]+ us: select from users where id = 2$/)
+    expect(result[8]).to match(/^  prepare [0-9.]+ us, execute [0-9.]+ us, plan: primary key, pages: \d+ hits, 0 misses$/)
+    expect(result[9]).to match(/^db > statement +phase +count +p50 us +p90 us +p99 us +p99.9 us +max us$/)
+    expect(result[10..13].map { |line| line.split(/ {2,}/).first(3) }).to eq([
+                                                                             %w[insert prepare 2],
+                                                                             %w[insert execute 2],
+                                                                             %w[select prepare 2],
+                                                                             %w[select execute 2]
+                                                                           ])
+  end
+
+  it('keeps only the shortest separators in internal nodes') do
+    result = run_script([
+                          'create table people (email text(100), bio text(900), primary key (email))',
+                          'insert into people carol@example.com c',
+                          'insert into people alice@example.com a',
+                          'insert into people bob@example.com b',
+                          'insert into people carl@example.com c',
+                          'insert into people carla@example.com c',
+                          'insert into people carmen@example.com c',
+                          'select from people where email = carla@example.com',
+                          '.btree people',
+                          '.exit'
+                        ])
+    expect(result).to eq([
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > Executed.',
+                           'db > (carla@example.com, c)',
+                           'Executed.',
+                           'db > Tree:',
+                           '- internal (size 2)',
+                           '  - leaf (size 2)',
+                           '    - alice@example.com',
+                           '    - bob@example.com',
+                           '  - key b...',
+                           '  - leaf (size 2)',
+                           '    - carl@example.com',
+                           '    - carla@example.com',
+                           '  - key carl...',
+                           '  - leaf (size 2)',
+                           '    - carmen@example.com',
+                           '    - carol@example.com',
+                           'db > '
+                         ])
+  end
+  it('splits an internal node where both halves fit with their own prefix') do
+    script = ['create table t (k text(120), primary key (k))']
+    script += (0...1000).map { |i| "insert into t #{'a' * 110}#{format('%03d', i)}" }
+    script += (0...40).map { |i| "insert into t 0#{format('%03d', i)}" }
+    script += ['.check t', '.exit']
+    result = run_script(script)
+    expect(result[-2]).to match(/^db > Checked [0-9]+ pages in 1 trees: ok\.$/)
+  end
 end
@@ -0,0 +1,301 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "table.h"
+#include "catalog.h"
+#include "harness.h"
+#include "report.h"
+#include "vfs.h"
+
+/*
+  Standard workloads run straight against the engine (make bench, then bin/bench):
+    bin/bench [--rows 10000,100000] [--ops 10000] [--file bin/bench.db]
+              [--repeat 1] [--json results.json] [--compare baseline.json] [--threshold 10]
+              [--vfs posix] [--io-latency 0] [workload ...]
+  Every workload starts from a new database file holding the users table. Apart from the
+  insert workloads, the table is first loaded with the ids 1..rows, outside of the timing.
+  Each workload runs --repeat times per scale (--rows) and prints its throughput and latency
+  percentiles. The runs can be summed up in a JSON file, and compared with a baseline written
+  the same way (see report.h): the exit status is 1 when a benchmark regressed by more than
+  --threshold percent. make bench-check compares with bench/baseline.json.
+  --vfs picks how the file is stored (see vfs.h), --io-latency adds microseconds to every
+  read, write and sync of the file, to see how a change does on a slow disk.
+*/
+
+#define BENCH_MAX_SCALES 8
+// rows read by every range scan
+#define RANGE_SCAN_LENGTH 100
+
+typedef struct
+{
+    uint32_t scales[BENCH_MAX_SCALES];
+    uint32_t num_scales;
+    uint32_t ops;
+    const char *file;
+    uint32_t repeat;
+    const char *json;     /* NULL if the summaries aren't written */
+    const char *baseline; /* NULL if there is nothing to compare with */
+    double threshold;     /* relative change taken as noise */
+} BenchConfig;
+
+typedef struct
+{
+    const char *name;
+    bool loaded; /* the table holds the ids 1..rows before the timing starts */
+    void (*run)(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies);
+} Workload;
+
+static void run_sequential_insert(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    for (uint32_t id = 1; id <= rows; id++)
+    {
+        uint64_t start = bench_now();
+        bench_insert_user(table, id);
+        latencies_add(latencies, bench_now() - start);
+    }
+}
+
+static void run_random_insert(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    uint32_t *ids = bench_shuffled_ids(rows, 42);
+    for (uint32_t i = 0; i < rows; i++)
+    {
+        uint64_t start = bench_now();
+        bench_insert_user(table, ids[i]);
+        latencies_add(latencies, bench_now() - start);
+    }
+    free(ids);
+}
+
+static void run_point_lookup(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    uint64_t seed = 7;
+    for (uint32_t i = 0; i < config->ops; i++)
+    {
+        uint32_t id = 1 + bench_random_below(&seed, rows);
+        uint64_t start = bench_now();
+        bench_read_user(table, id);
+        latencies_add(latencies, bench_now() - start);
+    }
+}
+
+// a whole scan is a single operation, a few of them are enough
+static void run_full_scan(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    uint32_t scans = config->ops / 1000 > 0 ? config->ops / 1000 : 1;
+    for (uint32_t i = 0; i < scans; i++)
+    {
+        uint64_t start = bench_now();
+        pager_begin_scan(table->pager);
+        bench_scan_users(table, 0, rows);
+        pager_end_scan(table->pager);
+        latencies_add(latencies, bench_now() - start);
+    }
+}
+
+static void run_range_scan(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    uint64_t seed = 11;
+    for (uint32_t i = 0; i < config->ops; i++)
+    {
+        uint32_t id = 1 + bench_random_below(&seed, rows);
+        uint64_t start = bench_now();
+        bench_scan_users(table, id, RANGE_SCAN_LENGTH);
+        latencies_add(latencies, bench_now() - start);
+    }
+}
+
+// lookups of existing ids mixed with inserts of new ones, reads is a percentage
+static void run_mixed(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies, uint32_t reads)
+{
+    uint64_t seed = 13;
+    uint32_t next_id = rows + 1;
+    for (uint32_t i = 0; i < config->ops; i++)
+    {
+        bool read = bench_random_below(&seed, 100) < reads;
+        uint32_t id = 1 + bench_random_below(&seed, next_id - 1);
+        uint64_t start = bench_now();
+        if (read)
+            bench_read_user(table, id);
+        else
+            bench_insert_user(table, next_id++);
+        latencies_add(latencies, bench_now() - start);
+    }
+}
+
+static void run_mixed_read_heavy(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    run_mixed(table, rows, config, latencies, 95);
+}
+
+static void run_mixed_write_heavy(Table *table, uint32_t rows, BenchConfig *config, Latencies *latencies)
+{
+    run_mixed(table, rows, config, latencies, 50);
+}
+
+static Workload workloads[] = {
+    {"seq_insert", false, run_sequential_insert},
+    {"random_insert", false, run_random_insert},
+    {"point_lookup", true, run_point_lookup},
+    {"full_scan", true, run_full_scan},
+    {"range_scan", true, run_range_scan},
+    {"mixed_95_5", true, run_mixed_read_heavy},
+    {"mixed_50_50", true, run_mixed_write_heavy},
+};
+static const uint32_t num_workloads = sizeof(workloads) / sizeof(Workload);
+
+static BenchResult run_workload(Workload *workload, uint32_t rows, BenchConfig *config)
+{
+    bench_remove_database(config->file);
+    Database *db = db_open(config->file, false);
+    Table *table = db_find_table(db, DEFAULT_TABLE_NAME);
+    if (workload->loaded)
+    {
+        for (uint32_t id = 1; id <= rows; id++)
+            bench_insert_user(table, id);
+    }
+
+    Latencies *latencies = latencies_new(config->ops > rows ? config->ops : rows);
+    uint64_t start = bench_now();
+    workload->run(table, rows, config, latencies);
+    BenchResult result = bench_result(workload->name, rows, latencies, bench_now() - start);
+
+    latencies_free(latencies);
+    db_close(db);
+    bench_remove_database(config->file);
+    return result;
+}
+
+static bool parse_scales(char *list, BenchConfig *config)
+{
+    config->num_scales = 0;
+    for (char *scale = strtok(list, ","); scale != NULL; scale = strtok(NULL, ","))
+    {
+        if (config->num_scales == BENCH_MAX_SCALES || atoi(scale) <= 0)
+            return false;
+        config->scales[config->num_scales++] = atoi(scale);
+    }
+    return config->num_scales > 0;
+}
+
+static void usage()
+{
+    printf("Usage: bench [--rows n,...] [--ops n] [--file path] [--repeat n] [--json path] [--compare path] "
+           "[--threshold percent] [--vfs name] [--io-latency us] [workload ...]\nWorkloads:");
+    for (uint32_t i = 0; i < num_workloads; i++)
+        printf(" %s", workloads[i].name);
+    printf("\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchConfig config = {{10000, 100000}, 2, 10000, "bin/bench.db", 1, NULL, NULL, 0.10};
+    bool selected[sizeof(workloads) / sizeof(Workload)] = {false};
+    bool any_selected = false;
+    Vfs *vfs = vfs_default();
+    uint32_t io_latency_us = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc)
+        {
+            if (!parse_scales(argv[++i], &config))
+                usage();
+        }
+        else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc)
+        {
+            config.ops = atoi(argv[++i]);
+            if (config.ops == 0)
+                usage();
+        }
+        else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+            config.file = argv[++i];
+        else if (strcmp(argv[i], "--repeat") == 0 && i + 1 < argc)
+        {
+            config.repeat = atoi(argv[++i]);
+            if (config.repeat == 0)
+                usage();
+        }
+        else if (strcmp(argv[i], "--json") == 0 && i + 1 < argc)
+            config.json = argv[++i];
+        else if (strcmp(argv[i], "--compare") == 0 && i + 1 < argc)
+            config.baseline = argv[++i];
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            config.threshold = atof(argv[++i]) / 100;
+        else if (strcmp(argv[i], "--vfs") == 0 && i + 1 < argc)
+        {
+            vfs = vfs_find(argv[++i]);
+            if (vfs == NULL)
+                usage();
+        }
+        else if (strcmp(argv[i], "--io-latency") == 0 && i + 1 < argc)
+            io_latency_us = atoi(argv[++i]);
+        else
+        {
+            uint32_t w = 0;
+            while (w < num_workloads && strcmp(argv[i], workloads[w].name) != 0)
+                w++;
+            if (w == num_workloads)
+                usage();
+            selected[w] = any_selected = true;
+        }
+    }
+    if (io_latency_us > 0)
+        vfs = vfs_latency(vfs, io_latency_us * 1000ULL, io_latency_us * 1000ULL, io_latency_us * 1000ULL);
+    vfs_set_default(vfs);
+
+    BenchSummary summaries[BENCH_MAX_SCALES * (sizeof(workloads) / sizeof(Workload))];
+    uint32_t num_summaries = 0;
+    BenchResult *runs = malloc(config.repeat * sizeof(BenchResult));
+    bench_print_header();
+    for (uint32_t s = 0; s < config.num_scales; s++)
+    {
+        for (uint32_t w = 0; w < num_workloads; w++)
+        {
+            if (any_selected && !selected[w])
+                continue;
+            for (uint32_t r = 0; r < config.repeat; r++)
+            {
+                runs[r] = run_workload(&workloads[w], config.scales[s], &config);
+                bench_print(&runs[r]);
+            }
+            summaries[num_summaries++] = bench_summarize(runs, config.repeat);
+        }
+    }
+    free(runs);
+
+    if (config.json != NULL)
+    {
+        FILE *file = fopen(config.json, "w");
+        if (file == NULL)
+        {
+            printf("Unable to write %s\n", config.json);
+            exit(EXIT_FAILURE);
+        }
+        bench_write_json(file, summaries, num_summaries);
+        fclose(file);
+    }
+
+    if (config.baseline != NULL)
+    {
+        uint32_t baseline_count;
+        BenchSummary *baseline = bench_read_json(config.baseline, &baseline_count);
+        if (baseline == NULL)
+        {
+            printf("Unable to read %s\n", config.baseline);
+            exit(EXIT_FAILURE);
+        }
+        printf("\n");
+        uint32_t regressions = bench_compare(baseline, baseline_count, summaries, num_summaries, config.threshold);
+        free(baseline);
+        if (regressions > 0)
+        {
+            printf("%u regression(s) beyond %.0f%%\n", regressions, 100 * config.threshold);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <unistd.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "harness.h"
+#include "codegen.h"
+
+uint64_t bench_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+uint64_t bench_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return bench_now();
+#endif
+}
+
+uint64_t bench_random(uint64_t *state)
+{
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+uint64_t bench_random_below(uint64_t *state, uint64_t bound)
+{
+    return bench_random(state) % bound;
+}
+
+uint32_t *bench_shuffled_ids(uint32_t count, uint64_t seed)
+{
+    uint32_t *ids = malloc(count * sizeof(uint32_t));
+    for (uint32_t i = 0; i < count; i++)
+        ids[i] = i + 1;
+    // Fisher-Yates
+    for (uint32_t i = count; i > 1; i--)
+    {
+        uint32_t j = bench_random_below(&seed, i);
+        uint32_t swap = ids[i - 1];
+        ids[i - 1] = ids[j];
+        ids[j] = swap;
+    }
+    return ids;
+}
+
+// keeps the rows read by the benchmarks alive
+static volatile uint8_t sink;
+
+static void pack_user(Table *table, uint32_t id, uint32_t version, void *record)
+{
+    char username[32], email[64];
+    int32_t value = id;
+    void *values[3] = {&value, username, email};
+    uint32_t lengths[3] = {sizeof(int32_t)};
+    lengths[1] = sprintf(username, "user%u", id);
+    if (version == 0)
+        lengths[2] = sprintf(email, "person%u@example.com", id);
+    else
+        lengths[2] = sprintf(email, "person%u+%u@example.com", id, version);
+    record_pack(&(table->record_layout), values, lengths, record);
+}
+
+static void encode_id(uint32_t id, void *key)
+{
+    int32_t value = id;
+    key_encode_value(COLUMN_TYPE_INT32, sizeof(int32_t), &value, sizeof(int32_t), key);
+}
+
+// cursor on the row with the given id, NULL if there is none
+static Cursor *find_user(Table *table, uint32_t id)
+{
+    uint8_t key[KEY_MAX_SIZE];
+    encode_id(id, key);
+    Cursor *cursor = tree_find(table, key);
+    void *node = get_page(table->pager, cursor->page_num);
+    if (cursor->cell_num < *leaf_node_num_cells(node) && compare_keys(table, cursor_key(cursor), key) == 0)
+        return cursor;
+    free(cursor);
+    return NULL;
+}
+
+void bench_insert_user(Table *table, uint32_t id)
+{
+    Statement statement;
+    // zeroed like the records of the insert statements
+    memset(statement.record, 0, RECORD_MAX_SIZE);
+    pack_user(table, id, 0, statement.record);
+    execute_insert(&statement, table);
+    pager_trim(table->pager);
+}
+
+bool bench_read_user(Table *table, uint32_t id)
+{
+    Cursor *cursor = find_user(table, id);
+    bool found = cursor != NULL;
+    if (found)
+        sink += *(uint8_t *)cursor_value(cursor);
+    free(cursor);
+    pager_trim(table->pager);
+    return found;
+}
+
+void bench_scan_users(Table *table, uint32_t first_id, uint32_t count)
+{
+    uint8_t key[KEY_MAX_SIZE];
+    encode_id(first_id, key);
+    Cursor *cursor = tree_seek(table, key);
+    for (uint32_t i = 0; i < count && !(cursor->end_of_table); i++)
+    {
+        sink += *(uint8_t *)cursor_value(cursor);
+        cursor_advance(cursor);
+    }
+    free(cursor);
+    pager_trim(table->pager);
+}
+
+bool bench_update_user(Table *table, uint32_t id, uint32_t version)
+{
+    Cursor *cursor = find_user(table, id);
+    bool updated = cursor != NULL && table->schema.leaf_format == LEAF_FORMAT_ROWS;
+    if (updated)
+    {
+        void *node = get_page_for_write(table->pager, cursor->page_num);
+        void *value = leaf_node_value(table, node, cursor->cell_num);
+        memset(value, 0, table->layout.value_size);
+        pack_user(table, id, version, value);
+    }
+    free(cursor);
+    pager_trim(table->pager);
+    return updated;
+}
+
+void bench_remove_database(const char *file)
+{
+    char warm_file[PATH_MAX];
+    snprintf(warm_file, sizeof(warm_file), "%s%s", file, WARM_FILE_SUFFIX);
+    unlink(file);
+    unlink(warm_file);
+}
+
+Latencies *latencies_new(uint32_t capacity)
+{
+    Latencies *latencies = malloc(sizeof(Latencies));
+    latencies->samples = malloc(capacity * sizeof(uint64_t));
+    latencies->count = 0;
+    latencies->capacity = capacity;
+    return latencies;
+}
+
+void latencies_add(Latencies *latencies, uint64_t nanoseconds)
+{
+    if (latencies->count == latencies->capacity)
+    {
+        latencies->capacity *= 2;
+        latencies->samples = realloc(latencies->samples, latencies->capacity * sizeof(uint64_t));
+    }
+    latencies->samples[latencies->count++] = nanoseconds;
+}
+
+void latencies_free(Latencies *latencies)
+{
+    free(latencies->samples);
+    free(latencies);
+}
+
+static int compare_samples(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+void latencies_sort(Latencies *latencies)
+{
+    qsort(latencies->samples, latencies->count, sizeof(uint64_t), compare_samples);
+}
+
+// nearest rank, the samples have to be sorted
+uint64_t latencies_percentile(Latencies *latencies, double fraction)
+{
+    if (latencies->count == 0)
+        return 0;
+    uint32_t rank = (uint32_t)(fraction * latencies->count);
+    if (rank >= latencies->count)
+        rank = latencies->count - 1;
+    return latencies->samples[rank];
+}
+
+// Sums up the samples of a workload, elapsed is its whole duration in nanoseconds
+BenchResult bench_result(const char *workload, uint32_t scale, Latencies *latencies, uint64_t elapsed)
+{
+    BenchResult result;
+    strncpy(result.workload, workload, BENCH_NAME_SIZE);
+    result.workload[BENCH_NAME_SIZE] = 0;
+    result.scale = scale;
+    result.ops = latencies->count;
+    result.ops_per_sec = elapsed == 0 ? 0 : latencies->count * 1e9 / elapsed;
+
+    latencies_sort(latencies);
+    result.p50_us = latencies_percentile(latencies, 0.50) / 1000.0;
+    result.p99_us = latencies_percentile(latencies, 0.99) / 1000.0;
+    result.p999_us = latencies_percentile(latencies, 0.999) / 1000.0;
+    return result;
+}
+
+void bench_print_header()
+{
+    printf("%-16s %10s %10s %12s %10s %10s %10s\n", "workload", "rows", "ops", "ops/sec", "p50(us)", "p99(us)",
+           "p999(us)");
+}
+
+void bench_print(BenchResult *result)
+{
+    printf("%-16s %10u %10u %12.0f %10.2f %10.2f %10.2f\n", result->workload, result->scale, result->ops,
+           result->ops_per_sec, result->p50_us, result->p99_us, result->p999_us);
+    fflush(stdout);
+}
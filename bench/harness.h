@@ -0,0 +1,77 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+
+#ifndef HARNESS_HEADER
+#define HARNESS_HEADER
+
+/*
+  Shared pieces of the benchmarks: a monotonic clock, a deterministic random generator, the
+  operations on the rows of the users table and the latency samples of a workload, summed up
+  as throughput and percentiles.
+  Every operation is timed on its own, so the numbers describe the engine and not the
+  process startup and the stdio round trips of the rspec scripts.
+*/
+
+// nanoseconds from an arbitrary point, never goes backwards
+uint64_t bench_now();
+// Time stamp counter where the CPU has one (x86), otherwise bench_now.
+// BENCH_CYCLES_UNIT says which one the numbers are in.
+uint64_t bench_cycles();
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCH_CYCLES_UNIT "cycles"
+#else
+#define BENCH_CYCLES_UNIT "ns"
+#endif
+
+// splitmix64: fixed seeds give the same keys from one run to the next
+uint64_t bench_random(uint64_t *state);
+// uniform in [0, bound)
+uint64_t bench_random_below(uint64_t *state, uint64_t bound);
+// permutation of 1..count, shuffled with the given seed
+uint32_t *bench_shuffled_ids(uint32_t count, uint64_t seed);
+
+// Rows of the users table for a given id: (id, "user<id>", "person<id>@example.com").
+// Every operation ends with pager_trim, like a statement of the shell.
+void bench_insert_user(Table *table, uint32_t id);
+bool bench_read_user(Table *table, uint32_t id);
+// reads up to count rows, from the first id >= the given one
+void bench_scan_users(Table *table, uint32_t first_id, uint32_t count);
+// Rewrites the email of a row in its leaf cell ("person<id>+<version>@example.com").
+// Only row leaves are updated, and the secondary indexes are not maintained.
+bool bench_update_user(Table *table, uint32_t id, uint32_t version);
+// deletes a database file and its warm-up list, every workload starts cold
+void bench_remove_database(const char *file);
+
+typedef struct
+{
+  uint64_t *samples; /* nanoseconds per operation (cycles for the microbenchmarks) */
+  uint32_t count;
+  uint32_t capacity;
+} Latencies;
+
+Latencies *latencies_new(uint32_t capacity);
+void latencies_add(Latencies *latencies, uint64_t nanoseconds);
+void latencies_free(Latencies *latencies);
+void latencies_sort(Latencies *latencies);
+uint64_t latencies_percentile(Latencies *latencies, double fraction);
+
+#define BENCH_NAME_SIZE 31
+
+typedef struct
+{
+  char workload[BENCH_NAME_SIZE + 1];
+  uint32_t scale; /* rows in the table */
+  uint32_t ops;
+  double ops_per_sec;
+  double p50_us;
+  double p99_us;
+  double p999_us;
+} BenchResult;
+
+BenchResult bench_result(const char *workload, uint32_t scale, Latencies *latencies, uint64_t elapsed);
+void bench_print_header();
+void bench_print(BenchResult *result);
+
+#endif
@@ -0,0 +1,376 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "table.h"
+#include "catalog.h"
+#include "trace.h"
+#include "checksum.h"
+#include "harness.h"
+
+/*
+  Microbenchmarks of the node level kernels (make bench, then bin/micro):
+    bin/micro [--rows 100000] [--iterations 20000] [--file bin/micro.db] [kernel ...]
+  The users table is loaded with the ids 1..rows, then the whole file is kept in the buffer
+  pool so that the kernels measure the CPU work only, apart from get_page_miss. Every kernel
+  uses fixed seeds, and is timed with the time stamp counter in batches of calls when a
+  single call is too short to be timed on its own. Reported: median and p99 cost of a call.
+  Records are built with record_pack and read with record_column, the successors of the
+  serialize_row / deserialize_row of the fixed row layout.
+*/
+
+#define MICRO_BATCH 64
+
+typedef struct
+{
+    Database *db;
+    Table *table;
+    uint32_t rows;
+    uint32_t iterations;
+} MicroContext;
+
+typedef struct
+{
+    const char *name;
+    void (*run)(MicroContext *context, Latencies *samples);
+} Kernel;
+
+// keeps the results of the kernels alive
+static volatile uint32_t sink;
+
+static void encode_id(uint32_t id, void *key)
+{
+    int32_t value = id;
+    key_encode_value(COLUMN_TYPE_INT32, sizeof(int32_t), &value, sizeof(int32_t), key);
+}
+
+static void pack_user(Table *table, uint32_t id, void *record)
+{
+    char username[32], email[64];
+    int32_t value = id;
+    void *values[3] = {&value, username, email};
+    uint32_t lengths[3] = {sizeof(int32_t)};
+    lengths[1] = sprintf(username, "user%u", id);
+    lengths[2] = sprintf(email, "person%u@example.com", id);
+    record_pack(&(table->record_layout), values, lengths, record);
+}
+
+// A btree with the layout of the users table that is not in the catalog, its root is an empty leaf
+static Table *scratch_table(MicroContext *context)
+{
+    Pager *pager = context->table->pager;
+    Table *scratch = malloc(sizeof(Table));
+    *scratch = *(context->table);
+    scratch->num_indexes = 0;
+    scratch->hash_index = NULL;
+    scratch->root_page_num = get_unused_page_num(pager);
+    void *root = get_page_for_write(pager, scratch->root_page_num);
+    initialize_leaf_node(root);
+    set_node_root(root, true);
+    return scratch;
+}
+
+// inserts the even ids 2, 4, ... at the end of the root leaf of the scratch table
+static void fill_leaf(Table *scratch, uint32_t num_cells)
+{
+    uint8_t key[KEY_MAX_SIZE];
+    uint8_t record[RECORD_MAX_SIZE] = {0};
+    Cursor cursor = {scratch, scratch->root_page_num, 0, false};
+    for (uint32_t i = 0; i < num_cells; i++)
+    {
+        encode_id(2 * (i + 1), key);
+        pack_user(scratch, 2 * (i + 1), record);
+        cursor.cell_num = i;
+        leaf_node_insert(&cursor, key, record);
+    }
+}
+
+static void run_leaf_node_find(MicroContext *context, Latencies *samples)
+{
+    Table *table = context->table;
+    Cursor *start = table_start(table);
+    uint32_t page_num = start->page_num;
+    free(start);
+    void *node = get_page(table->pager, page_num);
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint8_t keys[MICRO_BATCH][KEY_MAX_SIZE];
+    uint64_t seed = 1;
+
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            memcpy(keys[j], leaf_node_key(table, node, bench_random_below(&seed, num_cells)), table->layout.key_size);
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            free(leaf_node_find(table, page_num, keys[j]));
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+}
+
+// a descent from the root to the leaf, the root has to be an internal node
+static void run_internal_node_find(MicroContext *context, Latencies *samples)
+{
+    Table *table = context->table;
+    if (get_node_type(get_page(table->pager, table->root_page_num)) != NODE_INTERNAL)
+        return;
+    uint8_t keys[MICRO_BATCH][KEY_MAX_SIZE];
+    uint64_t seed = 2;
+
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            encode_id(1 + bench_random_below(&seed, context->rows), keys[j]);
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            free(internal_node_find(table, table->root_page_num, keys[j]));
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+}
+
+// insert at the front of a leaf holding one cell less than its maximum: every cell moves
+static void run_leaf_node_insert(MicroContext *context, Latencies *samples)
+{
+    Table *scratch = scratch_table(context);
+    uint32_t num_cells = scratch->layout.leaf_max_cells - 1;
+    fill_leaf(scratch, num_cells);
+    uint8_t key[KEY_MAX_SIZE];
+    uint8_t record[RECORD_MAX_SIZE] = {0};
+    encode_id(1, key);
+    pack_user(scratch, 1, record);
+    Cursor cursor = {scratch, scratch->root_page_num, 0, false};
+
+    for (uint32_t i = 0; i < context->iterations; i++)
+    {
+        *leaf_node_num_cells(get_page(scratch->pager, scratch->root_page_num)) = num_cells;
+        uint64_t start_cycles = bench_cycles();
+        leaf_node_insert(&cursor, key, record);
+        latencies_add(samples, bench_cycles() - start_cycles);
+    }
+    free(scratch);
+}
+
+// Split of a full root leaf, in the middle. It includes the creation of the new root.
+// Every split takes 3 new pages, so they are limited to a few thousands.
+static void run_leaf_node_split(MicroContext *context, Latencies *samples)
+{
+    Table *scratch = scratch_table(context);
+    uint32_t num_cells = scratch->layout.leaf_max_cells;
+    fill_leaf(scratch, num_cells);
+    void *full_leaf = malloc(PAGE_SIZE);
+    memcpy(full_leaf, get_page(scratch->pager, scratch->root_page_num), PAGE_SIZE);
+    uint8_t key[KEY_MAX_SIZE];
+    uint8_t record[RECORD_MAX_SIZE] = {0};
+    encode_id(2 * (num_cells / 2) + 1, key);
+    pack_user(scratch, 2 * (num_cells / 2) + 1, record);
+    uint32_t splits = context->iterations < 2000 ? context->iterations : 2000;
+
+    for (uint32_t i = 0; i < splits; i++)
+    {
+        scratch->root_page_num = get_unused_page_num(scratch->pager);
+        memcpy(get_page_for_write(scratch->pager, scratch->root_page_num), full_leaf, PAGE_SIZE);
+        Cursor cursor = {scratch, scratch->root_page_num, num_cells / 2, false};
+        uint64_t start_cycles = bench_cycles();
+        leaf_node_split_and_insert(&cursor, key, record);
+        latencies_add(samples, bench_cycles() - start_cycles);
+    }
+    free(full_leaf);
+    free(scratch);
+}
+
+static void run_record_pack(MicroContext *context, Latencies *samples)
+{
+    RecordLayout *layout = &(context->table->record_layout);
+    uint8_t record[RECORD_MAX_SIZE];
+    int32_t id = 12345;
+    char username[] = "user12345", email[] = "person12345@example.com";
+    void *values[3] = {&id, username, email};
+    uint32_t lengths[3] = {sizeof(int32_t), strlen(username), strlen(email)};
+
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            sink += record_pack(layout, values, lengths, record);
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+}
+
+// reads every column of a record
+static void run_record_column(MicroContext *context, Latencies *samples)
+{
+    RecordLayout *layout = &(context->table->record_layout);
+    uint8_t record[RECORD_MAX_SIZE];
+    uint32_t length;
+    pack_user(context->table, 12345, record);
+
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+        {
+            for (uint32_t column = 0; column < layout->num_columns; column++)
+                sink += *(uint8_t *)record_column(layout, record, column, &length) + length;
+        }
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+}
+
+#define MICRO_HOT_PAGES 32
+
+static void run_get_page_hit(MicroContext *context, Latencies *samples)
+{
+    Pager *pager = context->table->pager;
+    uint32_t num_pages = pager->num_pages < MICRO_HOT_PAGES ? pager->num_pages : MICRO_HOT_PAGES;
+    uint64_t seed = 3;
+    uint32_t pages[MICRO_BATCH];
+
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            pages[j] = bench_random_below(&seed, num_pages);
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            sink += *(uint8_t *)get_page(pager, pages[j]);
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+}
+
+// The pool goes back to its usual capacity and the pages are read in a cycle longer than it,
+// so none of them is still there. The file is in the OS cache: this is the cost of the pool.
+static void run_get_page_miss(MicroContext *context, Latencies *samples)
+{
+    Pager *pager = context->table->pager;
+    pager->capacity = TABLE_MAX_PAGES;
+    pager_trim(pager);
+    if (pager->num_pages <= 2 * TABLE_MAX_PAGES)
+        return;
+
+    for (uint32_t i = 0; i < context->iterations; i++)
+    {
+        uint32_t page_num = i % pager->num_pages;
+        uint64_t start_cycles = bench_cycles();
+        sink += *(uint8_t *)get_page(pager, page_num);
+        latencies_add(samples, bench_cycles() - start_cycles);
+        pager_trim(pager);
+    }
+}
+
+// checksum of a page, computed by every flush and verified by every read from the file
+static void run_page_checksum(MicroContext *context, Latencies *samples)
+{
+    void *page = get_page(context->table->pager, context->table->root_page_num);
+    for (uint32_t i = 0; i < context->iterations; i++)
+    {
+        uint64_t start_cycles = bench_cycles();
+        sink += crc32c(page, PAGE_USABLE_SIZE);
+        latencies_add(samples, bench_cycles() - start_cycles);
+    }
+}
+
+// cost of an event recorded by a tracepoint compiled in with make TRACE=1
+static void run_trace_event(MicroContext *context, Latencies *samples)
+{
+    for (uint32_t i = 0; i < context->iterations; i += MICRO_BATCH)
+    {
+        uint64_t start_cycles = bench_cycles();
+        for (uint32_t j = 0; j < MICRO_BATCH; j++)
+            trace_event(TRACE_PAGE_READ, TRACE_PHASE_INSTANT, i + j);
+        latencies_add(samples, (bench_cycles() - start_cycles) / MICRO_BATCH);
+    }
+    trace_clear();
+}
+
+static Kernel kernels[] = {
+    {"leaf_node_find", run_leaf_node_find},
+    {"internal_node_find", run_internal_node_find},
+    {"leaf_node_insert", run_leaf_node_insert},
+    {"leaf_node_split", run_leaf_node_split},
+    {"record_pack", run_record_pack},
+    {"record_column", run_record_column},
+    {"get_page_hit", run_get_page_hit},
+    {"get_page_miss", run_get_page_miss},
+    {"page_checksum", run_page_checksum},
+    {"trace_event", run_trace_event},
+};
+static const uint32_t num_kernels = sizeof(kernels) / sizeof(Kernel);
+
+// loads the table, then reopens the file with every page in the pool
+static void micro_open(MicroContext *context, const char *file)
+{
+    bench_remove_database(file);
+    Database *db = db_open(file, false);
+    for (uint32_t id = 1; id <= context->rows; id++)
+        bench_insert_user(db_find_table(db, DEFAULT_TABLE_NAME), id);
+    db_close(db);
+
+    context->db = db_open(file, false);
+    context->table = db_find_table(context->db, DEFAULT_TABLE_NAME);
+    Pager *pager = context->db->pager;
+    pager->capacity = pager->num_pages + TABLE_MAX_PAGES;
+    for (uint32_t page_num = 0; page_num < pager->num_pages; page_num++)
+        get_page(pager, page_num);
+}
+
+static void usage()
+{
+    printf("Usage: micro [--rows n] [--iterations n] [--file path] [kernel ...]\nKernels:");
+    for (uint32_t i = 0; i < num_kernels; i++)
+        printf(" %s", kernels[i].name);
+    printf("\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    MicroContext context = {NULL, NULL, 100000, 20000};
+    const char *file = "bin/micro.db";
+    bool selected[sizeof(kernels) / sizeof(Kernel)] = {false};
+    bool any_selected = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--rows") == 0 && i + 1 < argc)
+            context.rows = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--iterations") == 0 && i + 1 < argc)
+            context.iterations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--file") == 0 && i + 1 < argc)
+            file = argv[++i];
+        else
+        {
+            uint32_t k = 0;
+            while (k < num_kernels && strcmp(argv[i], kernels[k].name) != 0)
+                k++;
+            if (k == num_kernels)
+                usage();
+            selected[k] = any_selected = true;
+        }
+    }
+    if (context.rows == 0 || context.iterations == 0)
+        usage();
+
+    micro_open(&context, file);
+    printf("%-20s %10s %12s %12s\n", "kernel", "samples", "p50(" BENCH_CYCLES_UNIT ")", "p99(" BENCH_CYCLES_UNIT ")");
+    for (uint32_t k = 0; k < num_kernels; k++)
+    {
+        if (any_selected && !selected[k])
+            continue;
+        Latencies *samples = latencies_new(context.iterations);
+        kernels[k].run(&context, samples);
+        if (samples->count == 0)
+            printf("%-20s skipped, not enough rows\n", kernels[k].name);
+        else
+        {
+            latencies_sort(samples);
+            printf("%-20s %10u %12lu %12lu\n", kernels[k].name, samples->count,
+                   (unsigned long)latencies_percentile(samples, 0.50),
+                   (unsigned long)latencies_percentile(samples, 0.99));
+        }
+        latencies_free(samples);
+        pager_trim(context.db->pager);
+    }
+
+    db_close(context.db);
+    bench_remove_database(file);
+    return 0;
+}
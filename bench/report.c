@@ -0,0 +1,149 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "report.h"
+
+// two sided 95% quantiles of Student's t for 1 to 30 degrees of freedom, then the normal one
+static const double t_95[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                              2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                              2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+#define T_95_NORMAL 1.960
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, uint32_t count)
+{
+    qsort(values, count, sizeof(double), compare_doubles);
+    return count % 2 == 1 ? values[count / 2] : (values[count / 2 - 1] + values[count / 2]) / 2;
+}
+
+// the runs are those of the same benchmark at the same scale
+BenchSummary bench_summarize(BenchResult *runs, uint32_t num_runs)
+{
+    BenchSummary summary;
+    double values[num_runs];
+    strcpy(summary.name, runs[0].workload);
+    summary.rows = runs[0].scale;
+    summary.runs = num_runs;
+
+    double sum = 0, squares = 0;
+    for (uint32_t i = 0; i < num_runs; i++)
+        sum += runs[i].ops_per_sec;
+    summary.ops_per_sec = sum / num_runs;
+    for (uint32_t i = 0; i < num_runs; i++)
+        squares += (runs[i].ops_per_sec - summary.ops_per_sec) * (runs[i].ops_per_sec - summary.ops_per_sec);
+    summary.ci95 = 0;
+    if (num_runs > 1)
+    {
+        double t = num_runs - 1 <= sizeof(t_95) / sizeof(double) ? t_95[num_runs - 2] : T_95_NORMAL;
+        summary.ci95 = t * sqrt(squares / (num_runs - 1)) / sqrt(num_runs);
+    }
+
+    for (uint32_t i = 0; i < num_runs; i++)
+        values[i] = runs[i].p50_us;
+    summary.p50_us = median(values, num_runs);
+    for (uint32_t i = 0; i < num_runs; i++)
+        values[i] = runs[i].p99_us;
+    summary.p99_us = median(values, num_runs);
+    for (uint32_t i = 0; i < num_runs; i++)
+        values[i] = runs[i].p999_us;
+    summary.p999_us = median(values, num_runs);
+    return summary;
+}
+
+void bench_write_json(FILE *file, BenchSummary *summaries, uint32_t count)
+{
+    fprintf(file, "{\"benchmarks\": [\n");
+    for (uint32_t i = 0; i < count; i++)
+    {
+        BenchSummary *summary = &summaries[i];
+        fprintf(file,
+                "{\"name\": \"%s\", \"rows\": %u, \"runs\": %u, \"ops_per_sec\": %.1f, \"ci95\": %.1f, "
+                "\"p50_us\": %.2f, \"p99_us\": %.2f, \"p999_us\": %.2f}%s\n",
+                summary->name, summary->rows, summary->runs, summary->ops_per_sec, summary->ci95, summary->p50_us,
+                summary->p99_us, summary->p999_us, i + 1 < count ? "," : "");
+    }
+    fprintf(file, "]}\n");
+}
+
+// Returns NULL if the file can't be read, the summaries are allocated with malloc
+BenchSummary *bench_read_json(const char *path, uint32_t *count)
+{
+    FILE *file = fopen(path, "r");
+    if (file == NULL)
+        return NULL;
+    char line[512];
+    uint32_t capacity = 16;
+    BenchSummary *summaries = malloc(capacity * sizeof(BenchSummary));
+    *count = 0;
+    while (fgets(line, sizeof(line), file) != NULL)
+    {
+        BenchSummary summary;
+        if (sscanf(line,
+                   "{\"name\": \"%31[^\"]\", \"rows\": %u, \"runs\": %u, \"ops_per_sec\": %lf, \"ci95\": %lf, "
+                   "\"p50_us\": %lf, \"p99_us\": %lf, \"p999_us\": %lf}",
+                   summary.name, &summary.rows, &summary.runs, &summary.ops_per_sec, &summary.ci95, &summary.p50_us,
+                   &summary.p99_us, &summary.p999_us) != 8)
+            continue;
+        if (*count == capacity)
+        {
+            capacity *= 2;
+            summaries = realloc(summaries, capacity * sizeof(BenchSummary));
+        }
+        summaries[(*count)++] = summary;
+    }
+    fclose(file);
+    return summaries;
+}
+
+static BenchSummary *find_summary(BenchSummary *summaries, uint32_t count, BenchSummary *wanted)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (strcmp(summaries[i].name, wanted->name) == 0 && summaries[i].rows == wanted->rows)
+            return &summaries[i];
+    }
+    return NULL;
+}
+
+// Prints the change of every benchmark against the baseline and returns the number of regressions.
+// threshold is the relative change of throughput considered as noise (0.1 for 10%).
+uint32_t bench_compare(BenchSummary *baseline, uint32_t baseline_count, BenchSummary *current, uint32_t current_count,
+                       double threshold)
+{
+    uint32_t regressions = 0;
+    printf("%-16s %10s %22s %22s %8s  %s\n", "workload", "rows", "baseline ops/sec", "current ops/sec", "change",
+           "verdict");
+    for (uint32_t i = 0; i < current_count; i++)
+    {
+        BenchSummary *now = &current[i];
+        BenchSummary *before = find_summary(baseline, baseline_count, now);
+        if (before == NULL)
+        {
+            printf("%-16s %10u %22s %12.0f ±%9.0f %8s  new\n", now->name, now->rows, "-", now->ops_per_sec, now->ci95,
+                   "-");
+            continue;
+        }
+
+        double change = (now->ops_per_sec - before->ops_per_sec) / before->ops_per_sec;
+        bool apart = now->ops_per_sec + now->ci95 < before->ops_per_sec - before->ci95 ||
+                     now->ops_per_sec - now->ci95 > before->ops_per_sec + before->ci95;
+        const char *verdict = "ok";
+        if (apart && change < -threshold)
+        {
+            verdict = "REGRESSION";
+            regressions++;
+        }
+        else if (apart && change > threshold)
+            verdict = "improved";
+        printf("%-16s %10u %12.0f ±%9.0f %12.0f ±%9.0f %+7.1f%%  %s\n", now->name, now->rows, before->ops_per_sec,
+               before->ci95, now->ops_per_sec, now->ci95, 100 * change, verdict);
+    }
+    return regressions;
+}
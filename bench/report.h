@@ -0,0 +1,41 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "harness.h"
+
+#ifndef REPORT_HEADER
+#define REPORT_HEADER
+
+/*
+  Regression tracking. Every benchmark is run several times; the runs are summed up as the mean
+  throughput with its 95% confidence interval (Student's t) and the medians of the percentiles.
+  Summaries are written as JSON, one benchmark per line so the file diffs well:
+    {"benchmarks": [
+    {"name": "seq_insert", "rows": 10000, "runs": 5, "ops_per_sec": ..., "ci95": ..., "p50_us": ..., ...},
+    ...
+    ]}
+  and read back from a file written that way (this is not a general JSON parser).
+  A benchmark regressed when its throughput dropped by more than the noise threshold and the
+  confidence intervals of the baseline and of the new runs don't overlap.
+*/
+
+typedef struct
+{
+  char name[BENCH_NAME_SIZE + 1];
+  uint32_t rows;
+  uint32_t runs;
+  double ops_per_sec; /* mean of the runs */
+  double ci95;        /* half width of the confidence interval of the mean */
+  double p50_us;      /* medians of the runs */
+  double p99_us;
+  double p999_us;
+} BenchSummary;
+
+BenchSummary bench_summarize(BenchResult *runs, uint32_t num_runs);
+void bench_write_json(FILE *file, BenchSummary *summaries, uint32_t count);
+BenchSummary *bench_read_json(const char *path, uint32_t *count);
+uint32_t bench_compare(BenchSummary *baseline, uint32_t baseline_count, BenchSummary *current, uint32_t current_count,
+                       double threshold);
+
+#endif
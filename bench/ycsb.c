@@ -0,0 +1,202 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "ycsb.h"
+
+#define ZIPFIAN_THETA 0.99
+
+static const YcsbMix mixes[] = {
+    {'A', {50, 50, 0, 0, 0}, YCSB_ZIPFIAN},
+    {'B', {95, 5, 0, 0, 0}, YCSB_ZIPFIAN},
+    {'C', {100, 0, 0, 0, 0}, YCSB_ZIPFIAN},
+    {'D', {95, 0, 5, 0, 0}, YCSB_LATEST},
+    {'E', {0, 0, 5, 95, 0}, YCSB_ZIPFIAN},
+    {'F', {50, 0, 0, 0, 50}, YCSB_ZIPFIAN},
+};
+
+static const char *distribution_names[] = {"uniform", "zipfian", "latest"};
+static const char *operation_names[] = {"read", "update", "insert", "scan", "read_modify_write"};
+
+bool ycsb_find_mix(char name, YcsbMix *mix)
+{
+    for (uint32_t i = 0; i < sizeof(mixes) / sizeof(YcsbMix); i++)
+    {
+        if (mixes[i].name == name)
+        {
+            *mix = mixes[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *ycsb_distribution_name(YcsbDistribution distribution)
+{
+    return distribution_names[distribution];
+}
+
+const char *ycsb_operation_name(YcsbOperation operation)
+{
+    return operation_names[operation];
+}
+
+bool ycsb_parse_distribution(const char *name, YcsbDistribution *distribution)
+{
+    for (uint32_t i = 0; i < sizeof(distribution_names) / sizeof(char *); i++)
+    {
+        if (strcmp(name, distribution_names[i]) == 0)
+        {
+            *distribution = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// sum of 1 / i^theta for i in (from, to]
+static double zeta(uint32_t from, uint32_t to)
+{
+    double sum = 0;
+    for (uint32_t i = from; i < to; i++)
+        sum += 1 / pow(i + 1, ZIPFIAN_THETA);
+    return sum;
+}
+
+static void key_generator_update_eta(KeyGenerator *generator)
+{
+    generator->eta = (1 - pow(2.0 / generator->num_items, 1 - ZIPFIAN_THETA)) /
+                     (1 - generator->zeta_2 / generator->zeta_n);
+}
+
+void key_generator_init(KeyGenerator *generator, YcsbDistribution distribution, uint32_t num_items, uint64_t seed)
+{
+    generator->distribution = distribution;
+    generator->seed = seed;
+    generator->num_items = num_items;
+    generator->zeta_2 = zeta(0, 2);
+    generator->zeta_n = zeta(0, num_items);
+    key_generator_update_eta(generator);
+}
+
+void key_generator_grow(KeyGenerator *generator, uint32_t num_items)
+{
+    generator->zeta_n += zeta(generator->num_items, num_items);
+    generator->num_items = num_items;
+    key_generator_update_eta(generator);
+}
+
+// rank in [0, num_items), 0 being the most popular
+static uint32_t zipfian_rank(KeyGenerator *generator)
+{
+    double u = (bench_random(&generator->seed) >> 11) * (1.0 / 9007199254740992.0);
+    double uz = u * generator->zeta_n;
+    if (uz < 1)
+        return 0;
+    if (uz < 1 + pow(0.5, ZIPFIAN_THETA))
+        return 1;
+    uint32_t rank = generator->num_items * pow(generator->eta * u - generator->eta + 1, 1 / (1 - ZIPFIAN_THETA));
+    return rank < generator->num_items ? rank : generator->num_items - 1;
+}
+
+// FNV-1a, spreads the popular ranks over the whole key space
+static uint64_t scramble(uint64_t rank)
+{
+    uint64_t hash = 0xCBF29CE484222325ull;
+    for (uint32_t i = 0; i < sizeof(uint64_t); i++)
+    {
+        hash ^= (rank >> (8 * i)) & 0xFF;
+        hash *= 0x100000001B3ull;
+    }
+    return hash;
+}
+
+// id in [1, num_items]
+uint32_t key_generator_next(KeyGenerator *generator)
+{
+    switch (generator->distribution)
+    {
+    case (YCSB_UNIFORM):
+        return 1 + bench_random_below(&generator->seed, generator->num_items);
+    case (YCSB_ZIPFIAN):
+        return 1 + scramble(zipfian_rank(generator)) % generator->num_items;
+    case (YCSB_LATEST):
+        return generator->num_items - zipfian_rank(generator);
+    }
+    return 1;
+}
+
+void ycsb_load(Table *table, uint32_t records)
+{
+    for (uint32_t id = 1; id <= records; id++)
+        bench_insert_user(table, id);
+}
+
+static YcsbOperation choose_operation(YcsbMix *mix, uint32_t percent)
+{
+    for (uint32_t i = 0; i < YCSB_NUM_OPERATIONS; i++)
+    {
+        if (percent < mix->percentages[i])
+            return i;
+        percent -= mix->percentages[i];
+    }
+    return YCSB_READ;
+}
+
+// Runs the operations of the mix on a table loaded with ycsb_load, every operation type gets its latencies
+YcsbRun *ycsb_run(Table *table, YcsbMix *mix, uint32_t records, uint32_t operations, uint64_t seed)
+{
+    YcsbRun *run = malloc(sizeof(YcsbRun));
+    for (uint32_t i = 0; i < YCSB_NUM_OPERATIONS; i++)
+        run->latencies[i] = latencies_new(operations * mix->percentages[i] / 100 + 16);
+    run->operations = operations;
+
+    KeyGenerator keys;
+    key_generator_init(&keys, mix->distribution, records, seed);
+    uint64_t choice_seed = seed ^ 0x5DEECE66Dull;
+    uint32_t next_id = records + 1;
+
+    uint64_t run_start = bench_now();
+    for (uint32_t i = 0; i < operations; i++)
+    {
+        YcsbOperation operation = choose_operation(mix, bench_random_below(&choice_seed, 100));
+        uint32_t id = operation == YCSB_INSERT ? next_id : key_generator_next(&keys);
+        uint32_t scan_length = 1 + bench_random_below(&choice_seed, YCSB_MAX_SCAN_LENGTH);
+
+        uint64_t start = bench_now();
+        switch (operation)
+        {
+        case (YCSB_READ):
+            bench_read_user(table, id);
+            break;
+        case (YCSB_UPDATE):
+            bench_update_user(table, id, i + 1);
+            break;
+        case (YCSB_INSERT):
+            bench_insert_user(table, id);
+            break;
+        case (YCSB_SCAN):
+            bench_scan_users(table, id, scan_length);
+            break;
+        case (YCSB_READ_MODIFY_WRITE):
+            bench_read_user(table, id);
+            bench_update_user(table, id, i + 1);
+            break;
+        }
+        latencies_add(run->latencies[operation], bench_now() - start);
+
+        // the new row can be picked by the next operations
+        if (operation == YCSB_INSERT)
+            key_generator_grow(&keys, next_id++);
+    }
+    run->elapsed = bench_now() - run_start;
+    return run;
+}
+
+void ycsb_run_free(YcsbRun *run)
+{
+    for (uint32_t i = 0; i < YCSB_NUM_OPERATIONS; i++)
+        latencies_free(run->latencies[i]);
+    free(run);
+}
@@ -0,0 +1,80 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+#include "harness.h"
+
+#ifndef YCSB_HEADER
+#define YCSB_HEADER
+
+/*
+  YCSB core workloads over the users table, driven through the table API. The records are the
+  ids 1..records, the operations pick their id from a distribution:
+  • uniform: every id alike
+  • zipfian: a few hot ids get most of the operations, spread over the key space (scrambled)
+  • latest: the most recently inserted ids are the hot ones
+  Mixes (percentages of read / update / insert / scan / read-modify-write):
+    A 50/50/0/0/0 zipfian     B 95/5/0/0/0 zipfian     C 100/0/0/0/0 zipfian
+    D 95/0/5/0/0 latest       E 0/0/5/95/0 zipfian     F 50/0/0/0/50 zipfian
+  The engine has no update statement: an update rewrites the record in its leaf cell, in place.
+*/
+
+typedef enum
+{
+  YCSB_UNIFORM,
+  YCSB_ZIPFIAN,
+  YCSB_LATEST
+} YcsbDistribution;
+
+typedef enum
+{
+  YCSB_READ,
+  YCSB_UPDATE,
+  YCSB_INSERT,
+  YCSB_SCAN,
+  YCSB_READ_MODIFY_WRITE
+} YcsbOperation;
+#define YCSB_NUM_OPERATIONS 5
+// a scan reads between 1 and this many rows
+#define YCSB_MAX_SCAN_LENGTH 100
+
+typedef struct
+{
+  char name;
+  uint32_t percentages[YCSB_NUM_OPERATIONS]; /* indexed by YcsbOperation */
+  YcsbDistribution distribution;
+} YcsbMix;
+
+// Zipfian generator of Gray et al. as in YCSB, theta = 0.99. The number of items can grow:
+// zeta is extended with the new items instead of being computed again.
+typedef struct
+{
+  YcsbDistribution distribution;
+  uint64_t seed;
+  uint32_t num_items;
+  double zeta_2;
+  double zeta_n;
+  double eta;
+} KeyGenerator;
+
+bool ycsb_find_mix(char name, YcsbMix *mix);
+const char *ycsb_distribution_name(YcsbDistribution distribution);
+const char *ycsb_operation_name(YcsbOperation operation);
+bool ycsb_parse_distribution(const char *name, YcsbDistribution *distribution);
+
+void key_generator_init(KeyGenerator *generator, YcsbDistribution distribution, uint32_t num_items, uint64_t seed);
+void key_generator_grow(KeyGenerator *generator, uint32_t num_items);
+uint32_t key_generator_next(KeyGenerator *generator);
+
+typedef struct
+{
+  uint64_t elapsed; /* nanoseconds for the whole run */
+  uint32_t operations;
+  Latencies *latencies[YCSB_NUM_OPERATIONS];
+} YcsbRun;
+
+void ycsb_load(Table *table, uint32_t records);
+YcsbRun *ycsb_run(Table *table, YcsbMix *mix, uint32_t records, uint32_t operations, uint64_t seed);
+void ycsb_run_free(YcsbRun *run);
+
+#endif
@@ -0,0 +1,99 @@
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "table.h"
+#include "catalog.h"
+#include "ycsb.h"
+
+/*
+  YCSB workloads on the users table (make bench, then bin/ycsb):
+    bin/ycsb [--workloads ABCDEF] [--distribution uniform|zipfian|latest] [--records 100000]
+             [--operations 100000] [--seed 1] [--file bin/ycsb.db]
+  Every workload loads a new database file, then runs its operations. The results are printed
+  as one JSON object per line and per workload, with the latencies of every operation type:
+    {"workload": "A", "distribution": "zipfian", "records": ..., "operations": ..., "ops_per_sec": ...,
+     "read": {"ops": ..., "p50_us": ..., "p99_us": ..., "p999_us": ...}, "update": {...}}
+*/
+
+static void print_run(YcsbMix *mix, uint32_t records, YcsbRun *run)
+{
+    printf("{\"workload\": \"%c\", \"distribution\": \"%s\", \"records\": %u, \"operations\": %u, "
+           "\"ops_per_sec\": %.1f",
+           mix->name, ycsb_distribution_name(mix->distribution), records, run->operations,
+           run->elapsed == 0 ? 0 : run->operations * 1e9 / run->elapsed);
+    for (uint32_t i = 0; i < YCSB_NUM_OPERATIONS; i++)
+    {
+        if (run->latencies[i]->count == 0)
+            continue;
+        BenchResult result = bench_result(ycsb_operation_name(i), records, run->latencies[i], run->elapsed);
+        printf(", \"%s\": {\"ops\": %u, \"p50_us\": %.2f, \"p99_us\": %.2f, \"p999_us\": %.2f}", result.workload,
+               result.ops, result.p50_us, result.p99_us, result.p999_us);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+static void usage()
+{
+    printf("Usage: ycsb [--workloads ABCDEF] [--distribution uniform|zipfian|latest] [--records n] "
+           "[--operations n] [--seed n] [--file path]\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *names = "ABCDEF";
+    const char *file = "bin/ycsb.db";
+    bool distribution_set = false;
+    YcsbDistribution distribution = YCSB_ZIPFIAN;
+    uint32_t records = 100000, operations = 100000;
+    uint64_t seed = 1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (i + 1 == argc)
+            usage();
+        if (strcmp(argv[i], "--workloads") == 0)
+            names = argv[++i];
+        else if (strcmp(argv[i], "--distribution") == 0)
+        {
+            if (!ycsb_parse_distribution(argv[++i], &distribution))
+                usage();
+            distribution_set = true;
+        }
+        else if (strcmp(argv[i], "--records") == 0)
+            records = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--operations") == 0)
+            operations = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--seed") == 0)
+            seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--file") == 0)
+            file = argv[++i];
+        else
+            usage();
+    }
+    if (records == 0 || operations == 0)
+        usage();
+
+    for (const char *name = names; *name != 0; name++)
+    {
+        YcsbMix mix;
+        if (!ycsb_find_mix(*name, &mix))
+            usage();
+        if (distribution_set)
+            mix.distribution = distribution;
+
+        bench_remove_database(file);
+        Database *db = db_open(file, false);
+        Table *table = db_find_table(db, DEFAULT_TABLE_NAME);
+        ycsb_load(table, records);
+        YcsbRun *run = ycsb_run(table, &mix, records, operations, seed);
+        print_run(&mix, records, run);
+        ycsb_run_free(run);
+        db_close(db);
+        bench_remove_database(file);
+    }
+    return 0;
+}
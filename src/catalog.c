@@ -0,0 +1,294 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "catalog.h"
+#include "index.h"
+#include "hash_index.h"
+#include "leaf_columns.h"
+
+// Catalog Record Layout
+const uint32_t CATALOG_KEY_SIZE = TABLE_NAME_SIZE + 1;
+const uint32_t CATALOG_ROOT_PAGE_OFFSET = 0;
+const uint32_t CATALOG_HASH_INDEX_OFFSET = CATALOG_ROOT_PAGE_OFFSET + sizeof(uint32_t);
+const uint32_t CATALOG_NUM_COLUMNS_OFFSET = CATALOG_HASH_INDEX_OFFSET + sizeof(uint32_t);
+const uint32_t CATALOG_COLUMNS_OFFSET = CATALOG_NUM_COLUMNS_OFFSET + sizeof(uint32_t);
+/* every column is described by (name, type, size) */
+const uint32_t CATALOG_COLUMN_NAME_SIZE = COLUMN_NAME_SIZE + 1;
+const uint32_t CATALOG_COLUMN_SIZE = CATALOG_COLUMN_NAME_SIZE + 2 * sizeof(uint32_t);
+/* column numbers of the primary key */
+const uint32_t CATALOG_NUM_KEY_COLUMNS_OFFSET = CATALOG_COLUMNS_OFFSET + TABLE_MAX_COLUMNS * CATALOG_COLUMN_SIZE;
+const uint32_t CATALOG_KEY_COLUMNS_OFFSET = CATALOG_NUM_KEY_COLUMNS_OFFSET + sizeof(uint32_t);
+const uint32_t CATALOG_NUM_INDEXES_OFFSET = CATALOG_KEY_COLUMNS_OFFSET + TABLE_MAX_COLUMNS * sizeof(uint32_t);
+const uint32_t CATALOG_INDEXES_OFFSET = CATALOG_NUM_INDEXES_OFFSET + sizeof(uint32_t);
+/* every index is described by (column, root page number, included columns) */
+const uint32_t CATALOG_INDEX_SIZE = 3 * sizeof(uint32_t);
+/* format of the leaves of the table */
+const uint32_t CATALOG_LEAF_FORMAT_OFFSET = CATALOG_INDEXES_OFFSET + TABLE_MAX_INDEXES * CATALOG_INDEX_SIZE;
+const uint32_t CATALOG_RECORD_SIZE = CATALOG_LEAF_FORMAT_OFFSET + sizeof(uint32_t);
+
+static uint32_t *catalog_root_page(void *record)
+{
+    return record + CATALOG_ROOT_PAGE_OFFSET;
+}
+static uint32_t *catalog_hash_index(void *record)
+{
+    return record + CATALOG_HASH_INDEX_OFFSET;
+}
+static uint32_t *catalog_num_columns(void *record)
+{
+    return record + CATALOG_NUM_COLUMNS_OFFSET;
+}
+static char *catalog_column_name(void *record, uint32_t column_num)
+{
+    return record + CATALOG_COLUMNS_OFFSET + column_num * CATALOG_COLUMN_SIZE;
+}
+static uint32_t *catalog_column_type(void *record, uint32_t column_num)
+{
+    return (void *)catalog_column_name(record, column_num) + CATALOG_COLUMN_NAME_SIZE;
+}
+static uint32_t *catalog_column_size(void *record, uint32_t column_num)
+{
+    return catalog_column_type(record, column_num) + 1;
+}
+static uint32_t *catalog_num_key_columns(void *record)
+{
+    return record + CATALOG_NUM_KEY_COLUMNS_OFFSET;
+}
+static uint32_t *catalog_key_column(void *record, uint32_t key_column_num)
+{
+    return record + CATALOG_KEY_COLUMNS_OFFSET + key_column_num * sizeof(uint32_t);
+}
+static uint32_t *catalog_num_indexes(void *record)
+{
+    return record + CATALOG_NUM_INDEXES_OFFSET;
+}
+static uint32_t *catalog_index_column(void *record, uint32_t index_num)
+{
+    return record + CATALOG_INDEXES_OFFSET + index_num * CATALOG_INDEX_SIZE;
+}
+static uint32_t *catalog_index_root(void *record, uint32_t index_num)
+{
+    return catalog_index_column(record, index_num) + 1;
+}
+static uint32_t *catalog_index_included_columns(void *record, uint32_t index_num)
+{
+    return catalog_index_column(record, index_num) + 2;
+}
+static uint32_t *catalog_leaf_format(void *record)
+{
+    return record + CATALOG_LEAF_FORMAT_OFFSET;
+}
+
+// columns of the table every database starts with
+Schema default_schema()
+{
+    Schema schema;
+    memset(&schema, 0, sizeof(Schema));
+    schema.num_columns = 3;
+    schema.columns[0] = column_definition("id", COLUMN_TYPE_INT32, sizeof(int32_t));
+    schema.columns[1] = column_definition("username", COLUMN_TYPE_TEXT, 32);
+    schema.columns[2] = column_definition("email", COLUMN_TYPE_TEXT, 255);
+    schema.num_key_columns = 1;
+    schema.key_columns[0] = 0;
+    return schema;
+}
+
+// the btree of a table maps the encoded primary key to the record compiled from its schema
+static Table *table_with_schema(Pager *pager, uint32_t root_page_num, const char *name, Schema *schema)
+{
+    RecordLayout record_layout = record_layout_compile(schema);
+    Table *table = table_new(pager, root_page_num,
+                             make_node_layout(record_layout.key_size, record_layout.max_size));
+    strncpy(table->name, name, TABLE_NAME_SIZE + 1);
+    table->schema = *schema;
+    table->record_layout = record_layout;
+    // the rows of a columnar leaf are sized by their minipage slots rather than by a cell
+    if (schema->leaf_format == LEAF_FORMAT_COLUMNS)
+        columnar_leaf_compile(table);
+    return table;
+}
+
+// table names are NUL padded so that keys compare with memcmp
+static void catalog_build_key(const char *name, void *key)
+{
+    memset(key, 0, CATALOG_KEY_SIZE);
+    strncpy(key, name, TABLE_NAME_SIZE);
+}
+
+static void catalog_serialize_table(Table *table, void *record)
+{
+    memset(record, 0, CATALOG_RECORD_SIZE);
+    *catalog_root_page(record) = table->root_page_num;
+    *catalog_hash_index(record) = table->hash_index != NULL ? table->hash_index->meta_page_num : 0;
+
+    *catalog_num_columns(record) = table->schema.num_columns;
+    for (uint32_t i = 0; i < table->schema.num_columns; i++)
+    {
+        ColumnDefinition *column = &(table->schema.columns[i]);
+        strncpy(catalog_column_name(record, i), column->name, COLUMN_NAME_SIZE);
+        *catalog_column_type(record, i) = column->type;
+        *catalog_column_size(record, i) = column->size;
+    }
+    *catalog_num_key_columns(record) = table->schema.num_key_columns;
+    for (uint32_t i = 0; i < table->schema.num_key_columns; i++)
+        *catalog_key_column(record, i) = table->schema.key_columns[i];
+
+    *catalog_num_indexes(record) = table->num_indexes;
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+    {
+        Index *index = table->indexes[i];
+        *catalog_index_column(record, i) = index->column;
+        *catalog_index_root(record, i) = index->tree->root_page_num;
+        *catalog_index_included_columns(record, i) = index->included_columns;
+    }
+    *catalog_leaf_format(record) = table->schema.leaf_format;
+}
+
+static Table *catalog_deserialize_table(Database *db, const char *name, void *record)
+{
+    Schema schema;
+    schema.num_columns = *catalog_num_columns(record);
+    for (uint32_t i = 0; i < schema.num_columns; i++)
+    {
+        schema.columns[i] = column_definition(catalog_column_name(record, i), *catalog_column_type(record, i),
+                                              *catalog_column_size(record, i));
+    }
+    schema.num_key_columns = *catalog_num_key_columns(record);
+    for (uint32_t i = 0; i < schema.num_key_columns; i++)
+        schema.key_columns[i] = *catalog_key_column(record, i);
+    schema.leaf_format = *catalog_leaf_format(record);
+    Table *table = table_with_schema(db->pager, *catalog_root_page(record), name, &schema);
+
+    for (uint32_t i = 0; i < *catalog_num_indexes(record); i++)
+    {
+        table->indexes[table->num_indexes++] =
+            index_open(db->pager, &(table->record_layout), *catalog_index_column(record, i),
+                       *catalog_index_included_columns(record, i), *catalog_index_root(record, i));
+    }
+    if (*catalog_hash_index(record) != 0)
+        table->hash_index = hash_index_open(db->pager, *catalog_hash_index(record), table->layout.key_size);
+
+    return table;
+}
+
+static void db_add_table(Database *db, Table *table)
+{
+    db->tables = realloc(db->tables, (db->num_tables + 1) * sizeof(Table *));
+    db->tables[db->num_tables++] = table;
+}
+
+/* Opening the database file
+initializing a pager data structure
+loading every table registered in the catalog */
+Database *db_open(const char *filename, bool compressed)
+{
+    Pager *pager = pager_open(filename, compressed);
+    // the pages that were hot when the file was last closed
+    pager_warm_up(pager);
+    bool new_database = (pager->num_pages == 0);
+    void *header = get_page(pager, 0);
+
+    if (new_database)
+    {
+        // New database file. Page 0 is the header, page 1 the root of the catalog (a leaf node).
+        header = get_page_for_write(pager, 0);
+        memset(header, 0, PAGE_SIZE);
+        strncpy(header, DB_HEADER_MAGIC, DB_HEADER_MAGIC_SIZE);
+        *db_header_catalog_root(header) = 1;
+
+        void *root_node = get_page_for_write(pager, 1);
+        initialize_leaf_node(root_node);
+        set_node_root(root_node, true);
+    }
+    else if (strncmp(header, DB_HEADER_MAGIC, DB_HEADER_MAGIC_SIZE) != 0)
+    {
+        printf("Db file has an unknown format.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    Database *db = malloc(sizeof(Database));
+    db->pager = pager;
+    db->num_tables = 0;
+    db->tables = NULL;
+    db->metrics = metrics_new();
+    db->catalog = table_new(pager, *db_header_catalog_root(header),
+                            make_node_layout(CATALOG_KEY_SIZE, CATALOG_RECORD_SIZE));
+
+    if (new_database)
+    {
+        Schema schema = default_schema();
+        db_create_table(db, DEFAULT_TABLE_NAME, &schema);
+        return db;
+    }
+
+    Cursor *cursor = table_start(db->catalog);
+    for (; !(cursor->end_of_table); cursor_advance(cursor))
+        db_add_table(db, catalog_deserialize_table(db, cursor_key(cursor), cursor_value(cursor)));
+    free(cursor);
+
+    return db;
+}
+
+/*
+• flushes the buffer pool to disk
+• closes the database file
+• frees the memory for the Pager, the tables and the Database data structures */
+void db_close(Database *db)
+{
+    for (uint32_t i = 0; i < db->num_tables; i++)
+        table_close(db->tables[i]);
+    table_close(db->catalog);
+    pager_close(db->pager);
+    free(db->tables);
+    free(db->metrics);
+    free(db);
+}
+
+Table *db_find_table(Database *db, const char *name)
+{
+    for (uint32_t i = 0; i < db->num_tables; i++)
+    {
+        if (strcmp(db->tables[i]->name, name) == 0)
+            return db->tables[i];
+    }
+    return NULL;
+}
+
+// Allocates the root page of a new table and registers it in the catalog.
+// Returns NULL if a table with the same name already exists.
+Table *db_create_table(Database *db, const char *name, Schema *schema)
+{
+    if (db_find_table(db, name) != NULL)
+        return NULL;
+
+    uint32_t root_page_num = get_unused_page_num(db->pager);
+    void *root_node = get_page_for_write(db->pager, root_page_num);
+    initialize_leaf_node(root_node);
+    set_node_root(root_node, true);
+
+    Table *table = table_with_schema(db->pager, root_page_num, name, schema);
+
+    uint8_t key[CATALOG_KEY_SIZE];
+    uint8_t record[CATALOG_RECORD_SIZE];
+    catalog_build_key(name, key);
+    catalog_serialize_table(table, record);
+    Cursor *cursor = tree_find(db->catalog, key);
+    leaf_node_insert(cursor, key, record);
+    free(cursor);
+
+    db_add_table(db, table);
+    return table;
+}
+
+// Rewrites the catalog record of a table, after one of its indexes was created
+void catalog_update_table(Database *db, Table *table)
+{
+    uint8_t key[CATALOG_KEY_SIZE];
+    catalog_build_key(table->name, key);
+
+    Cursor *cursor = tree_find(db->catalog, key);
+    void *node = get_page_for_write(db->pager, cursor->page_num);
+    catalog_serialize_table(table, leaf_node_value(db->catalog, node, cursor->cell_num));
+    free(cursor);
+}
@@ -0,0 +1,42 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+#include "metrics.h"
+
+#ifndef CATALOG_HEADER
+#define CATALOG_HEADER
+
+// table that every database starts with, used by the statements that don't name one
+#define DEFAULT_TABLE_NAME "users"
+
+/*
+  The catalog is a btree stored in the file like any table. It maps the name of a table
+  (NUL padded, ordered by memcmp) to a fixed size record describing it:
+  • the root page of its btree and the meta page of its hash index (0 if none)
+  • its schema: number of columns, then (name, type, size) for every column, then the
+    columns of its primary key
+  • its secondary indexes: number of indexes, then (column, root page, included columns)
+  All the tables are loaded when the database is opened, and share its pager.
+*/
+typedef struct
+{
+  Pager *pager;
+  Table *catalog;
+  uint32_t num_tables;
+  Table **tables;
+  Metrics *metrics; /* latencies of the statements, see codegen.c */
+} Database;
+
+// Catalog Record Layout
+extern const uint32_t CATALOG_KEY_SIZE;
+extern const uint32_t CATALOG_RECORD_SIZE;
+
+Schema default_schema();
+Database *db_open(const char *filename, bool compressed);
+void db_close(Database *db);
+Table *db_find_table(Database *db, const char *name);
+Table *db_create_table(Database *db, const char *name, Schema *schema);
+void catalog_update_table(Database *db, Table *table);
+
+#endif
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include "check.h"
+#include "index.h"
+#include "hash_index.h"
+
+// State of the walk of a single tree
+typedef struct
+{
+    Table *table;
+    const char *name;
+    uint32_t leaf_depth;         /* depth of the first leaf, all the others must be as deep */
+    bool seen_leaf;
+    uint32_t previous_next_leaf; /* sibling link of the last leaf visited */
+    uint8_t *last_key;           /* layout.key_size bytes, index keys can be longer than KEY_MAX_SIZE */
+    uint64_t rows;
+} TreeWalk;
+
+// A separator bounding the keys of a subtree, NULL on the sides of the tree
+typedef struct
+{
+    const uint8_t *separator;
+    uint32_t length;
+} Bound;
+
+Check *check_new(Pager *pager)
+{
+    Check *check = malloc(sizeof(Check));
+    check->pager = pager;
+    check->used_pages = calloc(pager->num_pages / 8 + 1, 1);
+    check->num_pages = 0;
+    check->num_problems = 0;
+    return check;
+}
+
+void check_free(Check *check)
+{
+    free(check->used_pages);
+    free(check);
+}
+
+static void report(Check *check, TreeWalk *walk, uint32_t page_num, const char *format, ...)
+{
+    if (check->num_problems++ >= CHECK_MAX_REPORTED)
+        return;
+    va_list arguments;
+    va_start(arguments, format);
+    printf("%s, page %d: ", walk->name, page_num);
+    vprintf(format, arguments);
+    printf("\n");
+    va_end(arguments);
+}
+
+// a separator compares as if it was padded with 0xFF, like in internal_node_find
+static bool separator_covers(Bound *bound, const void *key)
+{
+    return memcmp(bound->separator, key, bound->length) >= 0;
+}
+
+static void check_leaf(Check *check, TreeWalk *walk, uint32_t page_num, void *node, Bound *lower, Bound *upper)
+{
+    Table *table = walk->table;
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint32_t page_with_row;
+
+    if (table->schema.leaf_format != LEAF_FORMAT_ENCODED && num_cells > table->layout.leaf_max_cells)
+    {
+        report(check, walk, page_num, "%d cells, more than the %d that fit", num_cells, table->layout.leaf_max_cells);
+        return;
+    }
+    for (uint32_t i = 0; i < num_cells; i++)
+    {
+        void *key = leaf_node_key(table, node, i);
+        if ((walk->rows > 0 || i > 0) && compare_keys(table, walk->last_key, key) >= 0)
+            report(check, walk, page_num, "key of cell %d is not greater than the previous one", i);
+        if (lower->separator != NULL && separator_covers(lower, key))
+            report(check, walk, page_num, "key of cell %d belongs on the left of the separator above", i);
+        if (upper->separator != NULL && !separator_covers(upper, key))
+            report(check, walk, page_num, "key of cell %d belongs on the right of the separator above", i);
+        if (table->hash_index != NULL &&
+            (!hash_index_find(table->hash_index, key, &page_with_row) || page_with_row != page_num))
+            report(check, walk, page_num, "the hash index doesn't find the row of cell %d here", i);
+        memcpy(walk->last_key, key, table->layout.key_size);
+    }
+    walk->rows += num_cells;
+}
+
+static void check_node(Check *check, TreeWalk *walk, uint32_t page_num, uint32_t parent_page_num, uint32_t depth,
+                       Bound *lower, Bound *upper)
+{
+    Pager *pager = check->pager;
+    Table *table = walk->table;
+    if (page_num == 0 || page_num >= pager->num_pages)
+    {
+        report(check, walk, parent_page_num, "child page %d is not a page of the file", page_num);
+        return;
+    }
+    if (check->used_pages[page_num / 8] & (1 << (page_num % 8)))
+    {
+        report(check, walk, page_num, "page is used more than once");
+        return;
+    }
+    check->used_pages[page_num / 8] |= 1 << (page_num % 8);
+    check->num_pages++;
+
+    void *node = get_page(pager, page_num);
+    if (depth > 0 && *node_parent(node) != parent_page_num)
+        report(check, walk, page_num, "parent is page %d instead of %d", *node_parent(node), parent_page_num);
+    if (is_node_root(node) != (depth == 0))
+        report(check, walk, page_num, depth == 0 ? "root is not flagged as such" : "flagged as a root");
+
+    switch (get_node_type(node))
+    {
+    case (NODE_LEAF):
+        if (!walk->seen_leaf)
+            walk->leaf_depth = depth;
+        else if (walk->previous_next_leaf != page_num)
+            report(check, walk, page_num, "the previous leaf links to page %d instead", walk->previous_next_leaf);
+        if (depth != walk->leaf_depth)
+            report(check, walk, page_num, "leaf at depth %d instead of %d", depth, walk->leaf_depth);
+        walk->seen_leaf = true;
+        walk->previous_next_leaf = *leaf_node_next_leaf(node);
+        check_leaf(check, walk, page_num, node, lower, upper);
+        // no page is held from one leaf to the next
+        pager_trim(pager);
+        break;
+    case (NODE_INTERNAL):
+    {
+        uint32_t num_keys = *internal_node_num_keys(node);
+        if (num_keys == 0)
+            report(check, walk, page_num, "internal node without keys");
+        for (uint32_t i = 0; i <= num_keys; i++)
+            pager_prefetch(pager, *internal_node_child(table, node, i));
+
+        // the upper bound of a child is the lower bound of the next one
+        uint8_t separators[2][table->layout.key_size];
+        Bound child_lower = *lower, child_upper;
+        for (uint32_t i = 0; i <= num_keys; i++)
+        {
+            // the children may have evicted the node
+            node = get_page(pager, page_num);
+            uint32_t child_page_num = *internal_node_child(table, node, i);
+            child_upper = *upper;
+            if (i < num_keys)
+            {
+                child_upper.separator = separators[i % 2];
+                child_upper.length = internal_node_separator(table, node, i, separators[i % 2]);
+            }
+            check_node(check, walk, child_page_num, page_num, depth + 1, &child_lower, &child_upper);
+            child_lower = child_upper;
+        }
+        break;
+    }
+    default:
+        report(check, walk, page_num, "unknown node type %d", get_node_type(node));
+        break;
+    }
+}
+
+// Checks the btree of a table or of an index, returns its number of rows
+uint64_t check_tree(Check *check, Table *table, const char *name)
+{
+    TreeWalk walk;
+    Bound unbounded = {NULL, 0};
+    walk.table = table;
+    walk.name = name;
+    walk.seen_leaf = false;
+    walk.rows = 0;
+    walk.last_key = malloc(table->layout.key_size);
+    check_node(check, &walk, table->root_page_num, 0, 0, &unbounded, &unbounded);
+    if (walk.seen_leaf && walk.previous_next_leaf != 0)
+        report(check, &walk, table->root_page_num, "the last leaf links to page %d", walk.previous_next_leaf);
+    free(walk.last_key);
+    return walk.rows;
+}
+
+// The table btree then its secondary indexes, which must have a cell per row
+void check_table(Check *check, Table *table)
+{
+    char name[TABLE_NAME_SIZE + COLUMN_NAME_SIZE + 16];
+    uint64_t rows = check_tree(check, table, table->name);
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+    {
+        Index *index = table->indexes[i];
+        snprintf(name, sizeof(name), "%s index on %s", table->name, table->schema.columns[index->column].name);
+        uint64_t index_rows = check_tree(check, index->tree, name);
+        if (index_rows != rows)
+        {
+            TreeWalk walk = {.name = name};
+            report(check, &walk, index->tree->root_page_num, "%lu cells for %lu rows", (unsigned long)index_rows,
+                   (unsigned long)rows);
+        }
+    }
+}
+
+// Checks the catalog and all the tables, or only the named one. Prints the problems and a summary.
+bool check_database(Database *db, const char *table_name)
+{
+    Check *check = check_new(db->pager);
+    uint32_t num_trees = 0;
+    if (table_name == NULL)
+    {
+        check_tree(check, db->catalog, "catalog");
+        num_trees++;
+        for (uint32_t i = 0; i < db->num_tables; i++)
+        {
+            check_table(check, db->tables[i]);
+            num_trees += 1 + db->tables[i]->num_indexes;
+        }
+    }
+    else
+    {
+        Table *table = db_find_table(db, table_name);
+        check_table(check, table);
+        num_trees += 1 + table->num_indexes;
+    }
+
+    bool ok = check->num_problems == 0;
+    if (ok)
+        printf("Checked %lu pages in %d trees: ok.\n", (unsigned long)check->num_pages, num_trees);
+    else
+        printf("Checked %lu pages in %d trees: %lu problems.\n", (unsigned long)check->num_pages, num_trees,
+               (unsigned long)check->num_problems);
+    check_free(check);
+    return ok;
+}
@@ -0,0 +1,40 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+#include "catalog.h"
+
+#ifndef CHECK_HEADER
+#define CHECK_HEADER
+
+/*
+  Integrity check of the btrees of a database (.check). Every tree is walked depth first,
+  verifying that:
+  • the keys of every node are in order, and within the bounds set by the separators above
+  • every child points back to its parent and all the leaves are at the same depth
+  • the leaves are chained left to right, the last one ending the chain
+  • no page is used twice, by the same tree or by two of them, and none is past the file
+  • the hash index finds every row in its leaf, and every secondary index has a cell per row
+  Reading the pages verifies their checksum, the pager stops at the first corrupt one.
+  The walk holds no page between two leaves, so the buffer pool stays within its capacity
+  whatever the size of the tree, and the children of an internal node are prefetched.
+*/
+
+// problems reported before the check goes silent
+#define CHECK_MAX_REPORTED 20
+
+typedef struct
+{
+  Pager *pager;
+  uint8_t *used_pages; /* one bit per page of the file */
+  uint64_t num_pages;  /* pages of all the checked trees */
+  uint64_t num_problems;
+} Check;
+
+Check *check_new(Pager *pager);
+void check_free(Check *check);
+uint64_t check_tree(Check *check, Table *table, const char *name);
+void check_table(Check *check, Table *table);
+bool check_database(Database *db, const char *table_name);
+
+#endif
@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "checksum.h"
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+// reflected Castagnoli polynomial
+#define CRC32C_POLYNOMIAL 0x82F63B78u
+
+static uint32_t crc32c_table[256];
+static bool crc32c_table_ready = false;
+
+static void crc32c_table_build()
+{
+    for (uint32_t i = 0; i < 256; i++)
+    {
+        uint32_t crc = i;
+        for (uint32_t bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (crc & 1 ? CRC32C_POLYNOMIAL : 0);
+        crc32c_table[i] = crc;
+    }
+    crc32c_table_ready = true;
+}
+
+uint32_t crc32c_software(const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFFu;
+    if (!crc32c_table_ready)
+        crc32c_table_build();
+    for (size_t i = 0; i < length; i++)
+        crc = (crc >> 8) ^ crc32c_table[(crc ^ bytes[i]) & 0xFF];
+    return crc ^ 0xFFFFFFFFu;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static uint32_t crc32c_hardware(const void *data, size_t length)
+{
+    const uint8_t *bytes = data;
+    uint64_t crc = 0xFFFFFFFFu;
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, bytes + i, sizeof(uint64_t));
+        crc = _mm_crc32_u64(crc, word);
+    }
+    for (; i < length; i++)
+        crc = _mm_crc32_u8(crc, bytes[i]);
+    return (uint32_t)crc ^ 0xFFFFFFFFu;
+}
+#endif
+
+uint32_t crc32c(const void *data, size_t length)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("sse4.2"))
+        return crc32c_hardware(data, length);
+#endif
+    return crc32c_software(data, length);
+}
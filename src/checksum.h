@@ -0,0 +1,17 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef CHECKSUM_HEADER
+#define CHECKSUM_HEADER
+
+/*
+  CRC32C (Castagnoli polynomial), the checksum of the pages. It uses the crc32 instruction of
+  SSE 4.2 when the CPU has it, 8 bytes at a time, and a table driven loop otherwise: both give
+  the same values, so a file can move between machines.
+*/
+uint32_t crc32c(const void *data, size_t length);
+// the portable version, for the tests and the benchmarks
+uint32_t crc32c_software(const void *data, size_t length);
+
+#endif
@@ -1,6 +1,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
 #include "user_input.h"
 #include "codegen.h"
 #include "table.h"
@@ -23,124 +25,1094 @@
     La fonction strtok n'est pas « thread-safe ». Cela veut dire qu'elle ne doit pas être utilisée en parallèle par plusieurs threads,
     car elle utilise un unique pointeur vers la chaîne à découper pour les rappels suivants(une variable locale statique). */
 
-// Copies the input tokens into the statement, preventing buffer overflow
-PrepareResult prepare_insert(InputBuffer *input_buffer, Statement *statement)
+static PrepareResult parse_table_name(const char *name, Statement *statement)
+{
+    if (name == NULL)
+        return PREPARE_SYNTAX_ERROR;
+    if (strlen(name) > TABLE_NAME_SIZE)
+        return PREPARE_STRING_TOO_LONG;
+    strcpy(statement->table_name, name);
+    return PREPARE_SUCCESS;
+}
+
+// finds the table named by the statement, its schema is needed to parse the rest
+static PrepareResult resolve_table(Statement *statement, Database *db)
+{
+    statement->table = db_find_table(db, statement->table_name);
+    return statement->table != NULL ? PREPARE_SUCCESS : PREPARE_NO_SUCH_TABLE;
+}
+
+static bool parse_column(Table *table, const char *name, uint32_t *column)
+{
+    if (name == NULL)
+        return false;
+    int32_t column_num = schema_find_column(&(table->schema), name);
+    if (column_num < 0)
+        return false;
+    *column = column_num;
+    return true;
+}
+
+static uint8_t hex_digit(char c)
+{
+    return isdigit(c) ? c - '0' : tolower(c) - 'a' + 10;
+}
+
+// Encodes the value written by the user as it is stored in the records.
+// Numbers have to be entirely valid, blobs are written in hexadecimal.
+static PrepareResult parse_value(ColumnDefinition *column, const char *string, void *destination, uint32_t *length)
+{
+    char *end;
+    errno = 0;
+    *length = column->size;
+    switch (column->type)
+    {
+    case (COLUMN_TYPE_INT32):
+    {
+        long value = strtol(string, &end, 10);
+        if (*end != 0 || errno != 0 || value < INT32_MIN || value > INT32_MAX)
+            return PREPARE_SYNTAX_ERROR;
+        int32_t int32 = value;
+        memcpy(destination, &int32, sizeof(int32_t));
+        return PREPARE_SUCCESS;
+    }
+    case (COLUMN_TYPE_INT64):
+    {
+        int64_t int64 = strtoll(string, &end, 10);
+        if (*end != 0 || errno != 0)
+            return PREPARE_SYNTAX_ERROR;
+        memcpy(destination, &int64, sizeof(int64_t));
+        return PREPARE_SUCCESS;
+    }
+    case (COLUMN_TYPE_DOUBLE):
+    {
+        double real = strtod(string, &end);
+        if (*end != 0 || errno != 0)
+            return PREPARE_SYNTAX_ERROR;
+        memcpy(destination, &real, sizeof(double));
+        return PREPARE_SUCCESS;
+    }
+    case (COLUMN_TYPE_TEXT):
+        *length = strlen(string);
+        if (*length > column->size)
+            return PREPARE_STRING_TOO_LONG;
+        memcpy(destination, string, *length);
+        return PREPARE_SUCCESS;
+    case (COLUMN_TYPE_BLOB):
+        *length = strlen(string) / 2;
+        if (strlen(string) % 2 != 0)
+            return PREPARE_SYNTAX_ERROR;
+        if (*length > column->size)
+            return PREPARE_STRING_TOO_LONG;
+        for (uint32_t i = 0; i < *length; i++)
+        {
+            if (!isxdigit(string[2 * i]) || !isxdigit(string[2 * i + 1]))
+                return PREPARE_SYNTAX_ERROR;
+            ((uint8_t *)destination)[i] = hex_digit(string[2 * i]) << 4 | hex_digit(string[2 * i + 1]);
+        }
+        return PREPARE_SUCCESS;
+    }
+    return PREPARE_SYNTAX_ERROR;
+}
+
+/*
+    insert <value> ...
+    insert into <table> <value> ...
+    One value per column of the table, encoded into the record to insert
+*/
+PrepareResult prepare_insert(InputBuffer *input_buffer, Statement *statement, Database *db)
 {
     statement->type = STATEMENT_INSERT;
+    // zeroed so that the unused bytes of the cell are zeroed on disk
+    memset(statement->record, 0, RECORD_MAX_SIZE);
     const char *delimiter = " ";
-    strtok(input_buffer->buffer, delimiter); /* keyword 'select' or 'insert' */
-    char *id_string = strtok(NULL, delimiter);
-    char *username = strtok(NULL, delimiter);
-    char *email = strtok(NULL, delimiter);
-    if (id_string == NULL || username == NULL || email == NULL)
+    strtok(input_buffer->buffer, delimiter); /* keyword 'insert' */
+    char *token = strtok(NULL, delimiter);
+    PrepareResult result;
+    if (token != NULL && strcmp(token, "into") == 0)
+    {
+        result = parse_table_name(strtok(NULL, delimiter), statement);
+        if (result != PREPARE_SUCCESS)
+            return result;
+        token = strtok(NULL, delimiter);
+    }
+    result = resolve_table(statement, db);
+    if (result != PREPARE_SUCCESS)
+        return result;
+
+    Table *table = statement->table;
+    uint8_t values_buffer[RECORD_MAX_SIZE];
+    void *values[TABLE_MAX_COLUMNS];
+    uint32_t lengths[TABLE_MAX_COLUMNS];
+    uint8_t *value = values_buffer;
+    for (uint32_t i = 0; i < table->schema.num_columns; i++)
+    {
+        if (token == NULL)
+            return PREPARE_SYNTAX_ERROR;
+        result = parse_value(&(table->schema.columns[i]), token, value, &(lengths[i]));
+        if (result != PREPARE_SUCCESS)
+            return result;
+        values[i] = value;
+        value += table->schema.columns[i].size;
+        token = strtok(NULL, delimiter);
+    }
+    if (token != NULL)
         return PREPARE_SYNTAX_ERROR;
 
-    int id = atoi(id_string);
-    if (id < 0)
-        return PREPARE_NEGATIVE_ID;
-    if (strlen(username) > COLUMN_USERNAME_SIZE)
-        return PREPARE_STRING_TOO_LONG;
-    if (strlen(email) > COLUMN_EMAIL_SIZE)
-        return PREPARE_STRING_TOO_LONG;
+    record_pack(&(table->record_layout), values, lengths, statement->record);
+    return PREPARE_SUCCESS;
+}
+
+// appends the columns of a '*' or of a single column name to the projection of a select
+static bool parse_projection(const char *token, Statement *statement)
+{
+    Table *table = statement->table;
+    uint32_t column;
+    if (strcmp(token, "*") == 0)
+    {
+        if (statement->num_columns + table->schema.num_columns > MAX_PROJECTED_COLUMNS)
+            return false;
+        for (column = 0; column < table->schema.num_columns; column++)
+            statement->columns[statement->num_columns++] = column;
+        return true;
+    }
+    if (!parse_column(table, token, &column) || statement->num_columns >= MAX_PROJECTED_COLUMNS)
+        return false;
+    statement->columns[statement->num_columns++] = column;
+    return true;
+}
+
+/*
+    select [* | <column>, ...] [from <table>]
+    select [* | <column>, ...] [from <table>] where <column> = <value>
+    select [* | <column>, ...] [from <table>] where <column> like <prefix>%     (text columns only)
+*/
+PrepareResult prepare_select(InputBuffer *input_buffer, Statement *statement, Database *db)
+{
+    statement->type = STATEMENT_SELECT;
+    statement->where.type = PREDICATE_NONE;
+    statement->num_columns = 0;
+    const char *delimiter = " ";
+    const char *list_delimiter = " ,";
+    strtok(input_buffer->buffer, delimiter); /* keyword 'select' */
+    char *keyword = strtok(NULL, list_delimiter);
+    // every token until 'from' or 'where' is a projected column, resolved once the table is known
+    char *projection[MAX_PROJECTED_COLUMNS];
+    uint32_t num_projected = 0;
+    while (keyword != NULL && strcmp(keyword, "from") != 0 && strcmp(keyword, "where") != 0)
+    {
+        if (num_projected >= MAX_PROJECTED_COLUMNS)
+            return PREPARE_SYNTAX_ERROR;
+        projection[num_projected++] = keyword;
+        keyword = strtok(NULL, list_delimiter);
+    }
+    PrepareResult result;
+    if (keyword != NULL && strcmp(keyword, "from") == 0)
+    {
+        result = parse_table_name(strtok(NULL, delimiter), statement);
+        if (result != PREPARE_SUCCESS)
+            return result;
+        keyword = strtok(NULL, delimiter);
+        if (keyword != NULL && strcmp(keyword, "where") != 0)
+            return PREPARE_SYNTAX_ERROR;
+    }
+    result = resolve_table(statement, db);
+    if (result != PREPARE_SUCCESS)
+        return result;
+
+    for (uint32_t i = 0; i < num_projected; i++)
+    {
+        if (!parse_projection(projection[i], statement))
+            return PREPARE_SYNTAX_ERROR;
+    }
+    if (statement->num_columns == 0)
+        parse_projection("*", statement);
+    if (keyword == NULL)
+        return PREPARE_SUCCESS;
+
+    char *column_name = strtok(NULL, delimiter);
+    char *comparison = strtok(NULL, delimiter);
+    char *value = strtok(NULL, delimiter);
+    Predicate *where = &(statement->where);
+    if (!parse_column(statement->table, column_name, &(where->column)) ||
+        comparison == NULL || value == NULL || strtok(NULL, delimiter) != NULL)
+        return PREPARE_SYNTAX_ERROR;
+
+    if (strcmp(comparison, "=") == 0)
+        where->type = PREDICATE_EQUALS;
+    else if (strcmp(comparison, "like") == 0 &&
+             statement->table->schema.columns[where->column].type == COLUMN_TYPE_TEXT)
+    {
+        // only prefixes are supported: the single % has to be the last character
+        char *wildcard = strchr(value, '%');
+        if (wildcard == NULL || wildcard[1] != 0)
+            return PREPARE_SYNTAX_ERROR;
+        *wildcard = 0;
+        where->type = PREDICATE_PREFIX;
+    }
+    else
+        return PREPARE_SYNTAX_ERROR;
+
+    return parse_value(&(statement->table->schema.columns[where->column]), value, where->value, &(where->length));
+}
 
-    statement->row_to_insert.id = id;
-    strcpy(statement->row_to_insert.username, username);
-    strcpy(statement->row_to_insert.email, email);
+// <type> of a column definition, int is a synonym of int32
+static bool parse_column_type(const char *name, ColumnType *type)
+{
+    if (strcmp(name, "int32") == 0 || strcmp(name, "int") == 0)
+        *type = COLUMN_TYPE_INT32;
+    else if (strcmp(name, "int64") == 0)
+        *type = COLUMN_TYPE_INT64;
+    else if (strcmp(name, "double") == 0)
+        *type = COLUMN_TYPE_DOUBLE;
+    else if (strcmp(name, "text") == 0)
+        *type = COLUMN_TYPE_TEXT;
+    else if (strcmp(name, "blob") == 0)
+        *type = COLUMN_TYPE_BLOB;
+    else
+        return false;
+    return true;
+}
 
+// primary key (<column>, ...), the last clause of a schema
+static PrepareResult parse_primary_key(Schema *schema)
+{
+    const char *list_delimiter = " ,()";
+    char *key = strtok(NULL, list_delimiter);
+    char *name = strtok(NULL, list_delimiter);
+    if (key == NULL || strcmp(key, "key") != 0 || name == NULL)
+        return PREPARE_SYNTAX_ERROR;
+    for (; name != NULL; name = strtok(NULL, list_delimiter))
+    {
+        int32_t column = schema_find_column(schema, name);
+        if (column < 0 || schema_is_key_column(schema, column))
+            return PREPARE_SYNTAX_ERROR;
+        schema->key_columns[schema->num_key_columns++] = column;
+    }
     return PREPARE_SUCCESS;
 }
 
-PrepareResult prepare_statement(InputBuffer *input_buffer, Statement *statement)
+/*
+    (<column> <type> [(<maximum length>)], ... [, primary key (<column>, ...)])
+    Text and blob columns have a maximum length, COLUMN_DEFAULT_VARIABLE_SIZE if it isn't given.
+    The primary key is the first column if it isn't given.
+*/
+static PrepareResult parse_schema(char *token, Schema *schema)
 {
-    if (strncmp(input_buffer->buffer, "insert", 6) == 0)
+    const char *list_delimiter = " ,()";
+    PrepareResult result;
+    memset(schema, 0, sizeof(Schema));
+    while (token != NULL)
+    {
+        if (strcmp(token, "primary") == 0)
+        {
+            result = parse_primary_key(schema);
+            if (result != PREPARE_SUCCESS)
+                return result;
+            break;
+        }
+        char *name = token;
+        char *type_name = strtok(NULL, list_delimiter);
+        ColumnType type;
+        if (schema->num_columns >= TABLE_MAX_COLUMNS || type_name == NULL || !parse_column_type(type_name, &type) ||
+            schema_find_column(schema, name) >= 0)
+            return PREPARE_SYNTAX_ERROR;
+        if (strlen(name) > COLUMN_NAME_SIZE)
+            return PREPARE_STRING_TOO_LONG;
+
+        uint32_t size = column_type_width(type);
+        token = strtok(NULL, list_delimiter);
+        if (column_type_is_variable(type))
+        {
+            size = COLUMN_DEFAULT_VARIABLE_SIZE;
+            if (token != NULL && isdigit(token[0]))
+            {
+                size = atoi(token);
+                token = strtok(NULL, list_delimiter);
+            }
+            if (size == 0)
+                return PREPARE_SYNTAX_ERROR;
+            if (size > RECORD_MAX_SIZE)
+                return PREPARE_RECORD_TOO_LARGE;
+        }
+        schema->columns[schema->num_columns++] = column_definition(name, type, size);
+    }
+
+    if (schema->num_columns == 0)
+        return PREPARE_SYNTAX_ERROR;
+    if (schema->num_key_columns == 0)
+        schema->key_columns[schema->num_key_columns++] = 0;
+
+    RecordLayout layout = record_layout_compile(schema);
+    if (layout.max_size > RECORD_MAX_SIZE)
+        return PREPARE_RECORD_TOO_LARGE;
+    if (layout.key_size > KEY_MAX_SIZE)
+        return PREPARE_KEY_TOO_LARGE;
+    return PREPARE_SUCCESS;
+}
+
+// <column> or <table>.<column>
+static PrepareResult parse_qualified_column(char *name, Statement *statement, Database *db, uint32_t *column)
+{
+    char *dot = name != NULL ? strchr(name, '.') : NULL;
+    PrepareResult result;
+    if (dot != NULL)
     {
-        return prepare_insert(input_buffer, statement);
+        *dot = 0;
+        result = parse_table_name(name, statement);
+        if (result != PREPARE_SUCCESS)
+            return result;
+        name = dot + 1;
     }
-    if (strcmp(input_buffer->buffer, "select") == 0)
+    result = resolve_table(statement, db);
+    if (result != PREPARE_SUCCESS)
+        return result;
+    return parse_column(statement->table, name, column) ? PREPARE_SUCCESS : PREPARE_SYNTAX_ERROR;
+}
+
+/*
+    create [encoded | columnar] table <table> [(<column> <type>, ...)]     (the columns of users by default)
+    create index on [<table>.]<column> [include <column>, ...]
+    create hash index on [<table>.]<primary key column>     (single column primary keys only)
+    The leaves of an encoded table store their rows column by column (see leaf_encoding.h),
+    the leaves of a columnar table keep a minipage per column (see leaf_columns.h).
+*/
+PrepareResult prepare_create(InputBuffer *input_buffer, Statement *statement, Database *db)
+{
+    statement->type = STATEMENT_CREATE_INDEX;
+    statement->index_included_columns = 0;
+    const char *delimiter = " ";
+    const char *list_delimiter = " ,";
+    strtok(input_buffer->buffer, delimiter); /* keyword 'create' */
+    char *object = strtok(NULL, delimiter);
+    PrepareResult result;
+    LeafFormat leaf_format = LEAF_FORMAT_ROWS;
+    if (object != NULL && (strcmp(object, "encoded") == 0 || strcmp(object, "columnar") == 0))
     {
-        statement->type = STATEMENT_SELECT;
+        leaf_format = strcmp(object, "encoded") == 0 ? LEAF_FORMAT_ENCODED : LEAF_FORMAT_COLUMNS;
+        object = strtok(NULL, delimiter);
+        if (object == NULL || strcmp(object, "table") != 0)
+            return PREPARE_SYNTAX_ERROR;
+    }
+    if (object != NULL && strcmp(object, "table") == 0)
+    {
+        statement->type = STATEMENT_CREATE_TABLE;
+        result = parse_table_name(strtok(NULL, " ("), statement);
+        if (result != PREPARE_SUCCESS)
+            return result;
+        char *token = strtok(NULL, " ,()");
+        if (token == NULL)
+            statement->schema = default_schema();
+        else
+        {
+            result = parse_schema(token, &(statement->schema));
+            if (result != PREPARE_SUCCESS)
+                return result;
+        }
+        statement->schema.leaf_format = leaf_format;
         return PREPARE_SUCCESS;
     }
+    if (object != NULL && strcmp(object, "hash") == 0)
+    {
+        statement->type = STATEMENT_CREATE_HASH_INDEX;
+        object = strtok(NULL, delimiter);
+    }
+    char *on = strtok(NULL, delimiter);
+    if (object == NULL || strcmp(object, "index") != 0 || on == NULL || strcmp(on, "on") != 0)
+        return PREPARE_SYNTAX_ERROR;
+    result = parse_qualified_column(strtok(NULL, delimiter), statement, db, &(statement->index_column));
+    if (result != PREPARE_SUCCESS)
+        return result;
+    // hash indexes are only for point lookups on the primary key
+    Schema *schema = &(statement->table->schema);
+    bool primary_key = schema->num_key_columns == 1 && schema->key_columns[0] == statement->index_column;
+    if (statement->type == STATEMENT_CREATE_HASH_INDEX)
+    {
+        if (!primary_key || strtok(NULL, delimiter) != NULL)
+            return PREPARE_SYNTAX_ERROR;
+        return PREPARE_SUCCESS;
+    }
+    // the table btree is already the index of the primary key
+    if (primary_key)
+        return PREPARE_SYNTAX_ERROR;
+
+    char *include = strtok(NULL, delimiter);
+    if (include == NULL)
+        return PREPARE_SUCCESS;
+    if (strcmp(include, "include") != 0)
+        return PREPARE_SYNTAX_ERROR;
+
+    // the primary key is always stored in the index and the indexed column is the key
+    uint32_t included;
+    char *included_name = strtok(NULL, list_delimiter);
+    if (included_name == NULL)
+        return PREPARE_SYNTAX_ERROR;
+    for (; included_name != NULL; included_name = strtok(NULL, list_delimiter))
+    {
+        if (!parse_column(statement->table, included_name, &included) || schema_is_key_column(schema, included) ||
+            included == statement->index_column)
+            return PREPARE_SYNTAX_ERROR;
+        statement->index_included_columns |= COLUMN_BIT(included);
+    }
+    return PREPARE_SUCCESS;
+}
+
+static PrepareResult parse_statement(InputBuffer *input_buffer, Statement *statement, Database *db)
+{
+    strcpy(statement->table_name, DEFAULT_TABLE_NAME);
+    statement->table = NULL;
+    statement->explain = EXPLAIN_NONE;
+    // explain [analyze] <statement>: the explained statement is parsed as if it was entered alone
+    if (strncmp(input_buffer->buffer, "explain ", 8) == 0)
+    {
+        uint32_t skipped = 8;
+        statement->explain = EXPLAIN_PLAN;
+        if (strncmp(input_buffer->buffer + skipped, "analyze ", 8) == 0)
+        {
+            skipped += 8;
+            statement->explain = EXPLAIN_ANALYZE;
+        }
+        memmove(input_buffer->buffer, input_buffer->buffer + skipped, strlen(input_buffer->buffer + skipped) + 1);
+        input_buffer->input_length -= skipped;
+    }
+    if (strncmp(input_buffer->buffer, "insert", 6) == 0)
+    {
+        return prepare_insert(input_buffer, statement, db);
+    }
+    if (strncmp(input_buffer->buffer, "select", 6) == 0)
+    {
+        return prepare_select(input_buffer, statement, db);
+    }
+    if (strncmp(input_buffer->buffer, "create", 6) == 0)
+    {
+        return prepare_create(input_buffer, statement, db);
+    }
     // no exceptions in C so let's just have a code for errors
     return PREPARE_UNRECOGNIZED_STATEMENT;
 }
 
-MetaCommandResult execute_meta_command(InputBuffer *input_buffer, Table *table)
+// names of the statement types and access paths in .latency and .slowlog
+static const char *statement_type_names[] = {"insert", "select", "create index", "create hash index",
+                                             "create table"};
+static const char *access_path_names[] = {"full scan", "primary key", "hash lookup", "index scan",
+                                          "covering index scan"};
+
+// Parses the input and times it, only the statements that parse have a type to be counted under
+PrepareResult prepare_statement(InputBuffer *input_buffer, Statement *statement, Database *db)
+{
+    uint64_t start = metrics_now();
+    strncpy(statement->text, input_buffer->buffer, SLOW_LOG_TEXT_SIZE);
+    statement->text[SLOW_LOG_TEXT_SIZE] = 0;
+    PrepareResult result = parse_statement(input_buffer, statement, db);
+    statement->prepare_ns = metrics_now() - start;
+    if (result == PREPARE_SUCCESS)
+        histogram_record(&(db->metrics->prepare[statement->type]), statement->prepare_ns);
+    return result;
+}
+
+MetaCommandResult execute_meta_command(InputBuffer *input_buffer, Database *db)
 {
     if (strcmp(input_buffer->buffer, ".exit") == 0)
     {
         close_input_buffer(input_buffer);
-        db_close(table);
+        db_close(db);
         exit(EXIT_SUCCESS);
     }
-    else if (strcmp(input_buffer->buffer, ".btree") == 0)
+    // .btree [<table>]
+    else if (strcmp(input_buffer->buffer, ".btree") == 0 || strncmp(input_buffer->buffer, ".btree ", 7) == 0)
     {
+        const char *name = input_buffer->buffer[6] != 0 ? input_buffer->buffer + 7 : DEFAULT_TABLE_NAME;
+        Table *table = db_find_table(db, name);
+        if (table == NULL)
+        {
+            printf("No such table '%s'.\n", name);
+            return META_COMMAND_SUCCESS;
+        }
         printf("Tree:\n");
-        print_tree(table->pager, 0, 0);
+        print_tree(table, table->root_page_num, 0);
+        return META_COMMAND_SUCCESS;
+    }
+    // .latency [reset]
+    else if (strcmp(input_buffer->buffer, ".latency") == 0)
+    {
+        print_latencies(db->metrics, statement_type_names, sizeof(statement_type_names) / sizeof(char *));
+        return META_COMMAND_SUCCESS;
+    }
+    else if (strcmp(input_buffer->buffer, ".latency reset") == 0)
+    {
+        metrics_reset(db->metrics);
+        return META_COMMAND_SUCCESS;
+    }
+    // .slowlog [off | <threshold in microseconds>]
+    else if (strcmp(input_buffer->buffer, ".slowlog") == 0)
+    {
+        print_slow_log(db->metrics);
+        return META_COMMAND_SUCCESS;
+    }
+    else if (strcmp(input_buffer->buffer, ".slowlog off") == 0)
+    {
+        db->metrics->slow_log_enabled = false;
+        return META_COMMAND_SUCCESS;
+    }
+    else if (strncmp(input_buffer->buffer, ".slowlog ", 9) == 0)
+    {
+        char *end;
+        double threshold_us = strtod(input_buffer->buffer + 9, &end);
+        if (end == input_buffer->buffer + 9 || *end != 0 || threshold_us < 0)
+            return META_COMMAND_UNRECOGNIZED_COMMAND;
+        db->metrics->slow_log_enabled = true;
+        db->metrics->slow_threshold_ns = threshold_us * 1e3;
+        return META_COMMAND_SUCCESS;
+    }
+    // .check [<table>], every table when none is named
+    else if (strcmp(input_buffer->buffer, ".check") == 0 || strncmp(input_buffer->buffer, ".check ", 7) == 0)
+    {
+        const char *name = input_buffer->buffer[6] != 0 ? input_buffer->buffer + 7 : NULL;
+        if (name != NULL && db_find_table(db, name) == NULL)
+            printf("No such table '%s'.\n", name);
+        else
+            check_database(db, name);
+        return META_COMMAND_SUCCESS;
+    }
+    // .trace [clear | <file>]
+    else if (strcmp(input_buffer->buffer, ".trace") == 0 || strncmp(input_buffer->buffer, ".trace ", 7) == 0)
+    {
+        const char *argument = input_buffer->buffer + 7;
+        if (!TRACE_ENABLED)
+            printf("Tracing is not compiled in, rebuild with make TRACE=1.\n");
+        else if (input_buffer->buffer[6] == 0)
+            printf("%lu events\n", (unsigned long)trace_count());
+        else if (strcmp(argument, "clear") == 0)
+            trace_clear();
+        else
+        {
+            FILE *file = fopen(argument, "w");
+            if (file == NULL)
+            {
+                printf("Unable to open '%s'.\n", argument);
+                return META_COMMAND_SUCCESS;
+            }
+            trace_export(file);
+            fclose(file);
+        }
+        return META_COMMAND_SUCCESS;
+    }
+    // .stats [<table>]
+    else if (strcmp(input_buffer->buffer, ".stats") == 0 || strncmp(input_buffer->buffer, ".stats ", 7) == 0)
+    {
+        const char *name = input_buffer->buffer[6] != 0 ? input_buffer->buffer + 7 : DEFAULT_TABLE_NAME;
+        Table *table = db_find_table(db, name);
+        if (table == NULL)
+        {
+            printf("No such table '%s'.\n", name);
+            return META_COMMAND_SUCCESS;
+        }
+        pager_print_stats(db->pager);
+        print_tree_stats(table);
+        return META_COMMAND_SUCCESS;
+    }
+    else if (strcmp(input_buffer->buffer, ".tables") == 0)
+    {
+        // the catalog is ordered by name
+        Cursor *cursor = table_start(db->catalog);
+        for (; !(cursor->end_of_table); cursor_advance(cursor))
+            printf("%s\n", (char *)cursor_key(cursor));
+        free(cursor);
         return META_COMMAND_SUCCESS;
     }
     else if (strcmp(input_buffer->buffer, ".constants") == 0)
     {
         printf("Constants:\n");
-        print_constants();
+        print_constants(db_find_table(db, DEFAULT_TABLE_NAME));
         return META_COMMAND_SUCCESS;
     }
     return META_COMMAND_UNRECOGNIZED_COMMAND;
 }
 
-ExecuteResult execute_select(Statement *statement, Table *table)
+static bool value_matches(Predicate *where, const void *value, uint32_t length)
 {
-    Row row;
-    Cursor *cursor = table_start(table);
-    while (!(cursor->end_of_table))
+    switch (where->type)
     {
-        void *slot = cursor_value(cursor);
-        if (slot == NULL)
-            return EXECUTE_FAILURE;
-        deserialize_row(slot, &row);
-        cursor_advance(cursor);
-        print_row(&row);
+    case (PREDICATE_EQUALS):
+        return length == where->length && memcmp(value, where->value, length) == 0;
+    case (PREDICATE_PREFIX):
+        return length >= where->length && memcmp(value, where->value, where->length) == 0;
+    default:
+        return true;
     }
+}
+
+static bool record_matches(Predicate *where, RecordLayout *layout, void *record)
+{
+    uint32_t length;
+    if (where->type == PREDICATE_NONE)
+        return true;
+    void *value = record_column(layout, record, where->column, &length);
+    return value_matches(where, value, length);
+}
+
+// Is the predicate an equality on the whole primary key.
+// The value is then encoded as a key of the table btree.
+static bool predicate_key(Predicate *where, Table *table, void *key)
+{
+    RecordLayout *layout = &(table->record_layout);
+    if (where->type != PREDICATE_EQUALS || layout->num_key_columns != 1 || layout->key_columns[0] != where->column)
+        return false;
+    ColumnDescriptor *descriptor = &(layout->columns[where->column]);
+    key_encode_value(descriptor->type, descriptor->size, where->value, where->length, key);
+    return true;
+}
+
+/*
+    Chooses how to reach the rows of a select:
+    • a primary key equality is a probe of the hash index if there is one,
+      a single descent of the table btree otherwise
+    • an equality or a prefix on an indexed column is a range scan of the index,
+      which doesn't even need the table when the index covers all the projected columns
+    • anything else reads the whole table and filters the rows
+*/
+AccessPath plan_select(Statement *statement, Table *table, Index **index)
+{
+    Predicate *where = &(statement->where);
+    uint8_t key[KEY_MAX_SIZE];
+    *index = NULL;
+
+    if (where->type == PREDICATE_NONE)
+        return ACCESS_FULL_SCAN;
+    if (predicate_key(where, table, key))
+        return table->hash_index != NULL ? ACCESS_HASH_LOOKUP : ACCESS_PRIMARY_KEY;
+
+    *index = table_find_index(table, where->column);
+    if (*index == NULL)
+        return ACCESS_FULL_SCAN;
+
+    uint32_t projected_columns = 0;
+    for (uint32_t i = 0; i < statement->num_columns; i++)
+        projected_columns |= COLUMN_BIT(statement->columns[i]);
+    if (index_covers(*index, projected_columns))
+        return ACCESS_COVERING_INDEX_SCAN;
+    return ACCESS_INDEX_SCAN;
+}
+
+// a row of the result, printed unless the statement only runs to be analyzed
+static void emit_row(Statement *statement, RecordLayout *layout, void *record)
+{
+    statement->analysis.rows_matched++;
+    if (statement->explain != EXPLAIN_ANALYZE)
+        print_record_columns(layout, record, statement->columns, statement->num_columns);
+}
+
+// only explain analyze pays for the timers
+static uint64_t analyze_clock(Statement *statement)
+{
+    return statement->explain == EXPLAIN_ANALYZE ? metrics_now() : 0;
+}
+
+// prints the projected columns of the row under the cursor if it has the given key, frees the cursor
+static bool print_row_at(Statement *statement, Cursor *cursor, const void *key)
+{
+    Table *table = cursor->table;
+    void *node = get_page(table->pager, cursor->page_num);
+    bool found = cursor->cell_num < *leaf_node_num_cells(node) &&
+                 compare_keys(table, cursor_key(cursor), key) == 0;
+    if (found)
+    {
+        statement->analysis.rows_scanned++;
+        emit_row(statement, &(table->record_layout), cursor_value(cursor));
+    }
+    free(cursor);
+    return found;
+}
+
+// prints the projected columns of the row with the given primary key, if there is one
+static bool print_row_with_key(Statement *statement, Table *table, const void *key)
+{
+    return print_row_at(statement, tree_find(table, key), key);
+}
+
+/*
+    Full scan of a columnar table, a leaf at a time. The predicate runs down the minipage of its
+    column and only the projected columns of the matching rows are read: the other minipages
+    are never touched and no record is rebuilt.
+*/
+static void scan_columnar_leaves(Statement *statement, Table *table)
+{
+    Predicate *where = &(statement->where);
+    RecordLayout *layout = &(table->record_layout);
+    uint32_t length;
+    void *value;
+    Cursor *cursor = table_start(table);
+    uint32_t page_num = cursor->end_of_table ? 0 : cursor->page_num;
     free(cursor);
+
+    while (page_num != 0)
+    {
+        pager_trim(table->pager); /* no page pointer is held between two leaves */
+        void *node = get_page(table->pager, page_num);
+        uint32_t num_cells = *leaf_node_num_cells(node);
+        statement->analysis.rows_scanned += num_cells;
+        for (uint32_t cell_num = 0; cell_num < num_cells; cell_num++)
+        {
+            if (where->type != PREDICATE_NONE)
+            {
+                uint64_t start = analyze_clock(statement);
+                value = columnar_leaf_column(table, node, cell_num, where->column, &length);
+                bool matches = value_matches(where, value, length);
+                statement->analysis.filter_ns += analyze_clock(statement) - start;
+                if (!matches)
+                    continue;
+            }
+            statement->analysis.rows_matched++;
+            if (statement->explain == EXPLAIN_ANALYZE)
+                continue;
+            printf("(");
+            for (uint32_t i = 0; i < statement->num_columns; i++)
+            {
+                if (i > 0)
+                    printf(", ");
+                value = columnar_leaf_column(table, node, cell_num, statement->columns[i], &length);
+                print_value(layout->columns[statement->columns[i]].type, value, length);
+            }
+            printf(")\n");
+        }
+        page_num = *leaf_node_next_leaf(node);
+    }
+}
+
+ExecuteResult execute_select(Statement *statement, Table *table)
+{
+    uint8_t record[RECORD_MAX_SIZE];
+    uint8_t key[KEY_MAX_SIZE];
+    Index *index;
+    Predicate *where = &(statement->where);
+    bool prefix = where->type == PREDICATE_PREFIX;
+    Cursor *cursor;
+    uint32_t page_num;
+    bool on_codes = where->type == PREDICATE_EQUALS && encoded_leaf_has_dictionary(table, where->column);
+    uint32_t code_page_num = 0; /* page 0 is never a leaf */
+    int32_t code = -1;
+
+    switch (plan_select(statement, table, &index))
+    {
+    case (ACCESS_PRIMARY_KEY):
+        predicate_key(where, table, key);
+        print_row_with_key(statement, table, key);
+        break;
+    case (ACCESS_HASH_LOOKUP):
+        // the hash index gives the leaf directly, we only search within that page
+        predicate_key(where, table, key);
+        if (hash_index_find(table->hash_index, key, &page_num))
+            print_row_at(statement, leaf_node_find(table, page_num, key), key);
+        break;
+    case (ACCESS_INDEX_SCAN):
+        cursor = index_seek(index, where->value, where->length);
+        while (index_cursor_matches(index, cursor, where->value, where->length, prefix))
+        {
+            if (!print_row_with_key(statement, table, index_cursor_primary_key(cursor)))
+            {
+                free(cursor);
+                return EXECUTE_FAILURE;
+            }
+            cursor_advance(cursor);
+        }
+        free(cursor);
+        break;
+    case (ACCESS_COVERING_INDEX_SCAN):
+        cursor = index_seek(index, where->value, where->length);
+        while (index_cursor_matches(index, cursor, where->value, where->length, prefix))
+        {
+            index_cursor_record(index, cursor, record);
+            statement->analysis.rows_scanned++;
+            emit_row(statement, &(table->record_layout), record);
+            cursor_advance(cursor);
+        }
+        free(cursor);
+        break;
+    case (ACCESS_FULL_SCAN):
+        // the leaves go through the scan ring, the pages of the point lookups stay in the pool
+        pager_begin_scan(table->pager);
+        if (table->schema.leaf_format == LEAF_FORMAT_COLUMNS)
+        {
+            scan_columnar_leaves(statement, table);
+            pager_end_scan(table->pager);
+            break;
+        }
+        cursor = table_start(table);
+        while (!(cursor->end_of_table))
+        {
+            statement->analysis.rows_scanned++;
+            // on encoded leaves, an equality on a text column is checked on the dictionary codes
+            // so the rows that don't match are not even decoded
+            if (on_codes)
+            {
+                uint64_t start = analyze_clock(statement);
+                void *node = get_page(table->pager, cursor->page_num);
+                if (code_page_num != cursor->page_num)
+                {
+                    code = encoded_leaf_find_code(table, node, where->column, where->value, where->length);
+                    code_page_num = cursor->page_num;
+                }
+                bool skipped = code < 0 ||
+                               encoded_leaf_code(table, node, where->column, cursor->cell_num) != (uint32_t)code;
+                statement->analysis.filter_ns += analyze_clock(statement) - start;
+                if (skipped)
+                {
+                    cursor_advance(cursor);
+                    continue;
+                }
+            }
+            // the record lives in the page, it has to be printed before the cursor moves
+            void *slot = cursor_value(cursor);
+            if (slot == NULL)
+            {
+                free(cursor);
+                pager_end_scan(table->pager);
+                return EXECUTE_FAILURE;
+            }
+            uint64_t start = analyze_clock(statement);
+            bool matches = record_matches(where, &(table->record_layout), slot);
+            statement->analysis.filter_ns += analyze_clock(statement) - start;
+            if (matches)
+                emit_row(statement, &(table->record_layout), slot);
+            cursor_advance(cursor);
+        }
+        free(cursor);
+        pager_end_scan(table->pager);
+        break;
+    }
     return EXECUTE_SUCCESS;
 }
 
-// Right now, our execute_insert() function always chooses to insert at the end of the table.
-// Instead, we should search the table for the correct place to insert, then insert there.
+// Search the table for the correct place to insert, then insert there.
 // If the key already exists there, return an error.
+// Every index of the table gets an entry for the new row.
 ExecuteResult execute_insert(Statement *statement, Table *table)
 {
-    // because we fill only 1 node so far
-    void *root_node = get_page(table->pager, table->root_page_num);
-    uint32_t node_num_cells = *leaf_node_num_cells(root_node);
+    uint8_t key_to_insert[KEY_MAX_SIZE];
+    record_build_key(&(table->record_layout), statement->record, key_to_insert);
 
-    Row *row_to_insert = &(statement->row_to_insert);
-    u_int32_t key_to_insert = row_to_insert->id;
-    Cursor *cursor = table_find(table, key_to_insert); /* finds the correct page_num/num_cell */
+    Cursor *cursor = tree_find(table, key_to_insert); /* finds the correct page_num/num_cell */
+    void *node = get_page(table->pager, cursor->page_num);
 
-    // checks if the key to insert is the same as one of the already existing keys
-    if (cursor->cell_num < node_num_cells)
+    // checks if the key to insert is the same as the one already at this position
+    if (cursor->cell_num < *leaf_node_num_cells(node))
     {
-        // root_node because we have only one node so far
-        uint32_t key_at_index = *leaf_node_key(root_node, cursor->cell_num);
-        if (key_at_index == key_to_insert)
+        void *key_at_index = leaf_node_key(table, node, cursor->cell_num);
+        if (compare_keys(table, key_at_index, key_to_insert) == 0)
+        {
+            free(cursor);
             return EXECUTE_DUPLICATE_KEY;
+        }
     }
 
-    // finally insert the cell
-    leaf_node_insert(cursor, row_to_insert->id, row_to_insert);
+    // the leaf is recorded before inserting, a split will then move the entry with the row
+    if (table->hash_index != NULL)
+        hash_index_insert(table->hash_index, key_to_insert, cursor->page_num);
 
+    // finally insert the cell
+    leaf_node_insert(cursor, key_to_insert, statement->record);
     free(cursor);
+
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+        index_insert_record(table->indexes[i], statement->record);
+
     return EXECUTE_SUCCESS;
 }
 
-ExecuteResult execute_statement(Statement *statement, Table *table)
+ExecuteResult execute_create_index(Statement *statement, Table *table)
 {
+    if (table_find_index(table, statement->index_column) != NULL)
+        return EXECUTE_INDEX_EXISTS;
+    if (index_create(table, statement->index_column, statement->index_included_columns) == NULL)
+        return EXECUTE_TOO_MANY_INDEXES;
+    return EXECUTE_SUCCESS;
+}
+
+ExecuteResult execute_create_hash_index(Statement *statement, Table *table)
+{
+    if (table->hash_index != NULL)
+        return EXECUTE_INDEX_EXISTS;
+    hash_index_create(table);
+    return EXECUTE_SUCCESS;
+}
+
+ExecuteResult execute_create_table(Statement *statement, Database *db)
+{
+    if (db_create_table(db, statement->table_name, &(statement->schema)) == NULL)
+        return EXECUTE_TABLE_EXISTS;
+    return EXECUTE_SUCCESS;
+}
+
+static ExecuteResult run_statement(Statement *statement, Database *db)
+{
+    Table *table = statement->table;
+    ExecuteResult result = EXECUTE_FAILURE;
     switch (statement->type)
     {
     case (STATEMENT_INSERT):
         return execute_insert(statement, table);
     case (STATEMENT_SELECT):
         return execute_select(statement, table);
+    case (STATEMENT_CREATE_TABLE):
+        return execute_create_table(statement, db);
+    case (STATEMENT_CREATE_INDEX):
+        result = execute_create_index(statement, table);
+        break;
+    case (STATEMENT_CREATE_HASH_INDEX):
+        result = execute_create_hash_index(statement, table);
+        break;
     }
-}
\ No newline at end of file
+    // the new index has to be found again when the database is reopened
+    if (result == EXECUTE_SUCCESS)
+        catalog_update_table(db, table);
+    return result;
+}
+
+static void print_predicate(Table *table, Predicate *where)
+{
+    ColumnDefinition *column = &(table->schema.columns[where->column]);
+    printf("%s %s ", column->name, where->type == PREDICATE_PREFIX ? "like" : "=");
+    print_value(column->type, where->value, where->length);
+    if (where->type == PREDICATE_PREFIX)
+        printf("%%");
+}
+
+// rows of the operator, then the time it took including the operators below it
+static void print_measures(Statement *statement, uint64_t rows, uint64_t elapsed)
+{
+    if (statement->explain == EXPLAIN_ANALYZE)
+        printf(" (rows %lu, time %.1f us)", (unsigned long)rows, elapsed / 1e3);
+    printf("\n");
+}
+
+static void print_page_measures(Statement *statement, uint64_t rows, uint64_t elapsed)
+{
+    Analysis *analysis = &(statement->analysis);
+    if (statement->explain == EXPLAIN_ANALYZE)
+        printf(" (rows %lu, pages %lu, misses %lu, time %.1f us)", (unsigned long)rows,
+               (unsigned long)analysis->pages, (unsigned long)analysis->misses, elapsed / 1e3);
+    printf("\n");
+}
+
+/*
+    Prints the operators of the statement as a tree, the root first:
+    a select projects the rows that pass its filter (full scans only, the other access paths
+    already select the matching rows), the rows being reached by the access path of plan_select.
+    Analyzed statements get the measures of every operator, the pages being those of the access.
+*/
+static void print_plan(Statement *statement)
+{
+    Table *table = statement->table;
+    Analysis *analysis = &(statement->analysis);
+    Index *index;
+    uint32_t level = 0;
+
+    switch (statement->type)
+    {
+    case (STATEMENT_SELECT):
+    {
+        AccessPath path = plan_select(statement, table, &index);
+        printf("- project ");
+        for (uint32_t i = 0; i < statement->num_columns; i++)
+            printf("%s%s", i > 0 ? ", " : "", table->schema.columns[statement->columns[i]].name);
+        print_measures(statement, analysis->rows_matched, analysis->execute_ns);
+        if (path == ACCESS_FULL_SCAN && statement->where.type != PREDICATE_NONE)
+        {
+            indent(++level);
+            printf("- filter ");
+            print_predicate(table, &(statement->where));
+            print_measures(statement, analysis->rows_matched, analysis->execute_ns);
+        }
+        indent(++level);
+        printf("- %s on %s", access_path_names[path], table->name);
+        if (index != NULL)
+            printf(" by index on %s", table->schema.columns[index->column].name);
+        if (path != ACCESS_FULL_SCAN)
+        {
+            printf(" where ");
+            print_predicate(table, &(statement->where));
+        }
+        print_page_measures(statement, analysis->rows_scanned, analysis->execute_ns - analysis->filter_ns);
+        break;
+    }
+    case (STATEMENT_INSERT):
+        printf("- insert into %s", table->name);
+        if (statement->explain == EXPLAIN_ANALYZE)
+            printf(" (rows 1, pages %lu, misses %lu, leaf splits %lu, time %.1f us)", (unsigned long)analysis->pages,
+                   (unsigned long)analysis->misses, (unsigned long)analysis->leaf_splits, analysis->execute_ns / 1e3);
+        printf("\n");
+        for (uint32_t i = 0; i < table->num_indexes; i++)
+        {
+            indent(1);
+            printf("- update index on %s\n", table->schema.columns[table->indexes[i]->column].name);
+        }
+        if (table->hash_index != NULL)
+        {
+            indent(1);
+            printf("- update hash index\n");
+        }
+        break;
+    case (STATEMENT_CREATE_INDEX):
+        printf("- create index on %s (%s)", table->name, table->schema.columns[statement->index_column].name);
+        print_page_measures(statement, 0, analysis->execute_ns);
+        break;
+    case (STATEMENT_CREATE_HASH_INDEX):
+        printf("- create hash index on %s", table->name);
+        print_page_measures(statement, 0, analysis->execute_ns);
+        break;
+    case (STATEMENT_CREATE_TABLE):
+        printf("- create table %s", statement->table_name);
+        print_page_measures(statement, 0, analysis->execute_ns);
+        break;
+    }
+}
+
+/*
+    Runs the statement and times it. A statement slower than the threshold (prepare and execute
+    together) goes to the slow log with its plan and the pages it asked the pager for.
+    An explained statement only prints its plan, an analyzed one runs and then prints it.
+*/
+ExecuteResult execute_statement(Statement *statement, Database *db)
+{
+    if (statement->explain == EXPLAIN_PLAN)
+    {
+        print_plan(statement);
+        return EXECUTE_SUCCESS;
+    }
+    Metrics *metrics = db->metrics;
+    PagerStats before = db->pager->stats;
+    uint64_t splits_before = statement->table != NULL ? statement->table->stats.leaf_splits : 0;
+    memset(&(statement->analysis), 0, sizeof(Analysis));
+    uint64_t start = metrics_now();
+    TRACE_BEGIN(TRACE_STATEMENT, statement->type);
+    ExecuteResult result = run_statement(statement, db);
+    TRACE_END(TRACE_STATEMENT, statement->type);
+    uint64_t elapsed = metrics_now() - start;
+    histogram_record(&(metrics->execute[statement->type]), elapsed);
+
+    if (statement->explain == EXPLAIN_ANALYZE && result == EXECUTE_SUCCESS)
+    {
+        Analysis *analysis = &(statement->analysis);
+        analysis->execute_ns = elapsed;
+        analysis->pages = db->pager->stats.hits + db->pager->stats.misses - before.hits - before.misses;
+        analysis->misses = db->pager->stats.misses - before.misses;
+        if (statement->table != NULL)
+            analysis->leaf_splits = statement->table->stats.leaf_splits - splits_before;
+        print_plan(statement);
+    }
+
+    if (!metrics->slow_log_enabled || statement->prepare_ns + elapsed < metrics->slow_threshold_ns)
+        return result;
+    SlowLogEntry *entry = slow_log_append(metrics, statement->text);
+    entry->prepare_ns = statement->prepare_ns;
+    entry->execute_ns = elapsed;
+    entry->page_hits = db->pager->stats.hits - before.hits;
+    entry->page_misses = db->pager->stats.misses - before.misses;
+    entry->plan = statement_type_names[statement->type];
+    if (statement->type == STATEMENT_SELECT)
+    {
+        Index *index;
+        entry->plan = access_path_names[plan_select(statement, statement->table, &index)];
+    }
+    return result;
+}
@@ -1,5 +1,12 @@
 #include "table.h"
+#include "catalog.h"
 #include "user_input.h"
+#include "index.h"
+#include "hash_index.h"
+#include "leaf_encoding.h"
+#include "leaf_columns.h"
+#include "trace.h"
+#include "check.h"
 
 #ifndef CODEGEN_HEADER
 #define CODEGEN_HEADER
@@ -13,21 +20,87 @@ typedef enum
 typedef enum
 {
   STATEMENT_INSERT,
-  STATEMENT_SELECT
+  STATEMENT_SELECT,
+  STATEMENT_CREATE_INDEX,
+  STATEMENT_CREATE_HASH_INDEX,
+  STATEMENT_CREATE_TABLE
 } StatementType;
 
+typedef enum
+{
+  PREDICATE_NONE,
+  PREDICATE_EQUALS, /* where column = value */
+  PREDICATE_PREFIX  /* where column like value% */
+} PredicateType;
+
+typedef struct
+{
+  PredicateType type;
+  uint32_t column;
+  uint8_t value[RECORD_MAX_SIZE]; // compared value (or prefix), encoded as in the records
+  uint32_t length;
+} Predicate;
+
+// The different ways the planner can reach the rows of a select
+typedef enum
+{
+  ACCESS_FULL_SCAN,           /* walk all the leaves of the table */
+  ACCESS_PRIMARY_KEY,         /* single descent of the table btree */
+  ACCESS_HASH_LOOKUP,         /* probe of the hash index, then a search in a single leaf */
+  ACCESS_INDEX_SCAN,          /* range of a secondary index, then a descent of the table per match */
+  ACCESS_COVERING_INDEX_SCAN  /* range of a secondary index holding all the needed columns */
+} AccessPath;
+
+// explain <statement> prints the plan, explain analyze <statement> runs it and measures every operator
+typedef enum
+{
+  EXPLAIN_NONE,
+  EXPLAIN_PLAN,
+  EXPLAIN_ANALYZE
+} ExplainMode;
+
+// What explain analyze measures while the statement runs.
+// The rows of a select are counted instead of being printed.
+typedef struct
+{
+  uint64_t rows_scanned; /* rows reached by the access path */
+  uint64_t rows_matched; /* rows that passed the filter, so rows of the result */
+  uint64_t filter_ns;
+  uint64_t execute_ns;
+  uint64_t pages;  /* pages asked to the pager */
+  uint64_t misses; /* pages read from the file */
+  uint64_t leaf_splits;
+} Analysis;
+
+// a column can be listed more than once: select id, id, *
+#define MAX_PROJECTED_COLUMNS (2 * TABLE_MAX_COLUMNS)
+
 typedef struct
 {
   StatementType type;
-  Row row_to_insert; // only used by insert statement
+  char table_name[TABLE_NAME_SIZE + 1];     // table the statement works on, DEFAULT_TABLE_NAME if not named
+  Table *table;                             // resolved when preparing, NULL for create table
+  uint8_t record[RECORD_MAX_SIZE];          // only used by insert statement
+  Predicate where;                          // only used by select statement
+  uint32_t columns[MAX_PROJECTED_COLUMNS];  // only used by select statement
+  uint32_t num_columns;                     // only used by select statement
+  uint32_t index_column;                    // only used by create index statement
+  uint32_t index_included_columns;          // only used by create index statement
+  Schema schema;                            // only used by create table statement
+  char text[SLOW_LOG_TEXT_SIZE + 1];         // the input, truncated, before the parser splits it
+  uint64_t prepare_ns;                      // time taken by prepare_statement
+  ExplainMode explain;
+  Analysis analysis;                        // only used by explain analyze
 } Statement;
 
 typedef enum
 {
   PREPARE_SUCCESS,
   PREPARE_SYNTAX_ERROR,
-  PREPARE_NEGATIVE_ID,
   PREPARE_STRING_TOO_LONG,
+  PREPARE_NO_SUCH_TABLE,
+  PREPARE_RECORD_TOO_LARGE,
+  PREPARE_KEY_TOO_LARGE,
   PREPARE_UNRECOGNIZED_STATEMENT
 } PrepareResult;
 
@@ -35,13 +108,20 @@ typedef enum
 {
   EXECUTE_SUCCESS,
   EXECUTE_DUPLICATE_KEY,
+  EXECUTE_TOO_MANY_INDEXES,
+  EXECUTE_INDEX_EXISTS,
+  EXECUTE_TABLE_EXISTS,
   EXECUTE_FAILURE,
 } ExecuteResult;
 
-MetaCommandResult execute_meta_command(InputBuffer *input_buffer, Table *table);
-PrepareResult prepare_statement(InputBuffer *input_buffer, Statement *statement);
-ExecuteResult execute_statement(Statement *statement, Table *table);
+MetaCommandResult execute_meta_command(InputBuffer *input_buffer, Database *db);
+PrepareResult prepare_statement(InputBuffer *input_buffer, Statement *statement, Database *db);
+ExecuteResult execute_statement(Statement *statement, Database *db);
 ExecuteResult execute_select(Statement *statement, Table *table);
 ExecuteResult execute_insert(Statement *statement, Table *table);
+ExecuteResult execute_create_index(Statement *statement, Table *table);
+ExecuteResult execute_create_hash_index(Statement *statement, Table *table);
+ExecuteResult execute_create_table(Statement *statement, Database *db);
+AccessPath plan_select(Statement *statement, Table *table, Index **index);
 
 #endif
\ No newline at end of file
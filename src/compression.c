@@ -0,0 +1,150 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "compression.h"
+
+// The compressor remembers the last position of every 4 bytes sequence in a small hash table
+#define LZ_HASH_BITS 12
+#define LZ_MAX_OFFSET 65535
+
+static uint32_t read_32(const uint8_t *bytes)
+{
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(uint32_t));
+    return value;
+}
+
+static uint32_t lz_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+// writes a count that didn't fit in its 4 bits of the token
+static bool lz_write_count(uint8_t *destination, uint32_t *position, uint32_t capacity, uint32_t count)
+{
+    for (; count >= 255; count -= 255)
+    {
+        if (*position >= capacity)
+            return false;
+        destination[(*position)++] = 255;
+    }
+    if (*position >= capacity)
+        return false;
+    destination[(*position)++] = count;
+    return true;
+}
+
+// Writes the literals followed by a match, or only the literals when match_length is 0
+static bool lz_write_sequence(uint8_t *destination, uint32_t *position, uint32_t capacity, const uint8_t *literals,
+                              uint32_t num_literals, uint32_t offset, uint32_t match_length)
+{
+    uint32_t match_count = match_length > 0 ? match_length - LZ_MIN_MATCH : 0;
+    if (*position >= capacity)
+        return false;
+    destination[(*position)++] = ((num_literals < 15 ? num_literals : 15) << 4) | (match_count < 15 ? match_count : 15);
+
+    if (num_literals >= 15 && !lz_write_count(destination, position, capacity, num_literals - 15))
+        return false;
+    if (*position + num_literals > capacity)
+        return false;
+    memcpy(destination + *position, literals, num_literals);
+    *position += num_literals;
+
+    if (match_length == 0)
+        return true;
+    if (*position + 2 > capacity)
+        return false;
+    destination[(*position)++] = offset & 0xFF;
+    destination[(*position)++] = offset >> 8;
+    if (match_count >= 15 && !lz_write_count(destination, position, capacity, match_count - 15))
+        return false;
+    return true;
+}
+
+uint32_t lz_compress(const void *source, uint32_t size, void *destination, uint32_t capacity)
+{
+    const uint8_t *input = source;
+    uint32_t table[1 << LZ_HASH_BITS] = {0}; /* position + 1, 0 means none */
+    uint32_t position = 0, anchor = 0, output = 0;
+
+    while (position + LZ_MIN_MATCH <= size)
+    {
+        uint32_t sequence = read_32(input + position);
+        uint32_t *slot = &table[lz_hash(sequence)];
+        uint32_t candidate = *slot;
+        *slot = position + 1;
+        if (candidate == 0 || position - (candidate - 1) > LZ_MAX_OFFSET ||
+            read_32(input + candidate - 1) != sequence)
+        {
+            position++;
+            continue;
+        }
+        candidate--;
+
+        // the match can overlap the current position, that's how runs of the same byte are encoded
+        uint32_t match_length = LZ_MIN_MATCH;
+        while (position + match_length < size && input[candidate + match_length] == input[position + match_length])
+            match_length++;
+
+        if (!lz_write_sequence(destination, &output, capacity, input + anchor, position - anchor,
+                               position - candidate, match_length))
+            return 0;
+        position += match_length;
+        anchor = position;
+    }
+
+    if (!lz_write_sequence(destination, &output, capacity, input + anchor, size - anchor, 0, 0))
+        return 0;
+    return output;
+}
+
+// reads a count that didn't fit in its 4 bits of the token
+static bool lz_read_count(const uint8_t *source, uint32_t *position, uint32_t length, uint32_t *count)
+{
+    uint8_t byte;
+    do
+    {
+        if (*position >= length)
+            return false;
+        byte = source[(*position)++];
+        *count += byte;
+    } while (byte == 255);
+    return true;
+}
+
+bool lz_decompress(const void *source, uint32_t length, void *destination, uint32_t size)
+{
+    const uint8_t *input = source;
+    uint8_t *output = destination;
+    uint32_t position = 0, written = 0;
+
+    while (position < length)
+    {
+        uint8_t token = input[position++];
+        uint32_t num_literals = token >> 4;
+        if (num_literals == 15 && !lz_read_count(input, &position, length, &num_literals))
+            return false;
+        if (position + num_literals > length || written + num_literals > size)
+            return false;
+        memcpy(output + written, input + position, num_literals);
+        position += num_literals;
+        written += num_literals;
+
+        if (position == length)
+            break;
+        if (position + 2 > length)
+            return false;
+        uint32_t offset = input[position] | (input[position + 1] << 8);
+        position += 2;
+        uint32_t match_length = token & 0x0F;
+        if (match_length == 15 && !lz_read_count(input, &position, length, &match_length))
+            return false;
+        match_length += LZ_MIN_MATCH;
+        if (offset == 0 || offset > written || written + match_length > size)
+            return false;
+        // byte by byte because the match may overlap what it produces
+        for (uint32_t i = 0; i < match_length; i++, written++)
+            output[written] = output[written - offset];
+    }
+    return written == size;
+}
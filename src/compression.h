@@ -0,0 +1,25 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef COMPRESSION_HEADER
+#define COMPRESSION_HEADER
+
+/*
+  Small LZ77 codec in the spirit of LZ4, used by the pager to store pages compressed.
+  Pages are mostly NUL padding and repeated column values, which it turns into a few
+  back references. The output is a list of sequences:
+  • a token: number of literals in the high 4 bits, match length - 4 in the low 4 bits
+    (15 means the count goes on in the next bytes, each adding up to 255)
+  • the literals
+  • the 2 bytes little endian offset of the match, counted backwards from the current position
+  The last sequence only has literals, the end of the input tells it apart.
+*/
+#define LZ_MIN_MATCH 4
+
+// Returns the size of the compressed data, or 0 when it would not fit in capacity
+uint32_t lz_compress(const void *source, uint32_t size, void *destination, uint32_t capacity);
+// Returns false if the data is corrupt or does not decompress to exactly size bytes
+bool lz_decompress(const void *source, uint32_t length, void *destination, uint32_t size);
+
+#endif
@@ -0,0 +1,260 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "hash_index.h"
+
+// FNV-1a over the bytes of the key. Keys are mostly dense and sequential, so the result is
+// mixed again before picking a bucket with its low bits (finalizer of murmur3).
+static uint32_t hash_key(HashIndex *hash_index, const void *key)
+{
+    const uint8_t *bytes = key;
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < hash_index->key_size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6b;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+static uint32_t *hash_meta_global_depth(void *meta)
+{
+    return meta + HASH_META_GLOBAL_DEPTH_OFFSET;
+}
+static uint32_t *hash_meta_num_directory_pages(void *meta)
+{
+    return meta + HASH_META_NUM_DIRECTORY_PAGES_OFFSET;
+}
+static uint32_t *hash_meta_directory_page(void *meta, uint32_t directory_page_index)
+{
+    return meta + HASH_META_DIRECTORY_PAGES_OFFSET + directory_page_index * sizeof(uint32_t);
+}
+static uint32_t *hash_bucket_local_depth(void *bucket)
+{
+    return bucket + HASH_BUCKET_LOCAL_DEPTH_OFFSET;
+}
+static uint32_t *hash_bucket_num_entries(void *bucket)
+{
+    return bucket + HASH_BUCKET_NUM_ENTRIES_OFFSET;
+}
+static void *hash_bucket_entry_key(HashIndex *hash_index, void *bucket, uint32_t entry_num)
+{
+    return bucket + HASH_BUCKET_HEADER_SIZE + entry_num * hash_index->bucket_entry_size;
+}
+static uint32_t *hash_bucket_entry_page(HashIndex *hash_index, void *bucket, uint32_t entry_num)
+{
+    return hash_bucket_entry_key(hash_index, bucket, entry_num) + hash_index->key_size;
+}
+
+// slot of the directory holding the page number of a bucket
+static uint32_t *hash_directory_slot(HashIndex *hash_index, uint32_t entry_num, bool for_write)
+{
+    void *meta = get_page(hash_index->pager, hash_index->meta_page_num);
+    uint32_t directory_page_num = *hash_meta_directory_page(meta, entry_num / HASH_DIRECTORY_ENTRIES_PER_PAGE);
+    void *directory = for_write ? get_page_for_write(hash_index->pager, directory_page_num)
+                                : get_page(hash_index->pager, directory_page_num);
+    return directory + HASH_DIRECTORY_ENTRIES_OFFSET +
+           (entry_num % HASH_DIRECTORY_ENTRIES_PER_PAGE) * sizeof(uint32_t);
+}
+
+// page number of the bucket stored in the given slot of the directory
+static uint32_t hash_directory_entry(HashIndex *hash_index, uint32_t entry_num)
+{
+    return *hash_directory_slot(hash_index, entry_num, false);
+}
+
+static void hash_directory_set_entry(HashIndex *hash_index, uint32_t entry_num, uint32_t bucket_page_num)
+{
+    *hash_directory_slot(hash_index, entry_num, true) = bucket_page_num;
+}
+
+// slot of the directory for a key: the global depth lowest bits of its hash
+static uint32_t hash_directory_index(HashIndex *hash_index, const void *key)
+{
+    void *meta = get_page(hash_index->pager, hash_index->meta_page_num);
+    uint32_t mask = (1u << *hash_meta_global_depth(meta)) - 1;
+    return hash_key(hash_index, key) & mask;
+}
+
+static void *hash_bucket_for(HashIndex *hash_index, const void *key, bool for_write)
+{
+    uint32_t bucket_page_num = hash_directory_entry(hash_index, hash_directory_index(hash_index, key));
+    if (for_write)
+        return get_page_for_write(hash_index->pager, bucket_page_num);
+    return get_page(hash_index->pager, bucket_page_num);
+}
+
+static uint32_t new_hash_page(Pager *pager, NodeType type)
+{
+    uint32_t page_num = get_unused_page_num(pager);
+    void *page = get_page_for_write(pager, page_num);
+    memset(page, 0, PAGE_SIZE);
+    set_node_type(page, type);
+    return page_num;
+}
+
+static uint32_t new_hash_bucket(Pager *pager, uint32_t local_depth)
+{
+    uint32_t page_num = new_hash_page(pager, NODE_HASH_BUCKET);
+    void *bucket = get_page_for_write(pager, page_num);
+    *hash_bucket_local_depth(bucket) = local_depth;
+    *hash_bucket_num_entries(bucket) = 0;
+    return page_num;
+}
+
+// The directory doubles by copying the first half into the second half:
+// both slots that share the same lower bits point to the same bucket until it splits.
+static void hash_directory_double(HashIndex *hash_index)
+{
+    Pager *pager = hash_index->pager;
+    void *meta = get_page_for_write(pager, hash_index->meta_page_num);
+    uint32_t size = 1u << *hash_meta_global_depth(meta);
+
+    uint32_t pages_needed = (2 * size + HASH_DIRECTORY_ENTRIES_PER_PAGE - 1) / HASH_DIRECTORY_ENTRIES_PER_PAGE;
+    if (pages_needed > HASH_META_MAX_DIRECTORY_PAGES)
+    {
+        printf("Hash index directory is full.\n");
+        exit(EXIT_FAILURE);
+    }
+    while (*hash_meta_num_directory_pages(meta) < pages_needed)
+    {
+        uint32_t directory_page_num = new_hash_page(pager, NODE_HASH_DIRECTORY);
+        *hash_meta_directory_page(meta, *hash_meta_num_directory_pages(meta)) = directory_page_num;
+        *hash_meta_num_directory_pages(meta) += 1;
+    }
+
+    for (uint32_t i = 0; i < size; i++)
+        hash_directory_set_entry(hash_index, size + i, hash_directory_entry(hash_index, i));
+    *hash_meta_global_depth(meta) += 1;
+}
+
+/*
+    Splits the bucket of the given directory slot on the next bit of the hash:
+    entries with the bit set move to a new bucket, and so do the directory slots
+    that have the bit set among the ones pointing to the old bucket.
+*/
+static void hash_bucket_split(HashIndex *hash_index, uint32_t directory_index)
+{
+    Pager *pager = hash_index->pager;
+    void *meta = get_page(pager, hash_index->meta_page_num);
+    uint32_t bucket_page_num = hash_directory_entry(hash_index, directory_index);
+    void *bucket = get_page_for_write(pager, bucket_page_num);
+    uint32_t local_depth = *hash_bucket_local_depth(bucket);
+
+    if (local_depth == *hash_meta_global_depth(meta))
+        hash_directory_double(hash_index);
+
+    uint32_t new_bucket_page_num = new_hash_bucket(pager, local_depth + 1);
+    void *new_bucket = get_page_for_write(pager, new_bucket_page_num);
+    *hash_bucket_local_depth(bucket) = local_depth + 1;
+
+    uint32_t bit = 1u << local_depth;
+    uint32_t num_entries = *hash_bucket_num_entries(bucket), kept = 0;
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        void *entry = hash_bucket_entry_key(hash_index, bucket, i);
+        void *destination = (hash_key(hash_index, entry) & bit) ? new_bucket : bucket;
+        uint32_t entry_num = (destination == bucket) ? kept++ : (*hash_bucket_num_entries(new_bucket))++;
+        // entries only move towards the start of the old bucket, memmove handles i == entry_num
+        memmove(hash_bucket_entry_key(hash_index, destination, entry_num), entry, hash_index->bucket_entry_size);
+    }
+    *hash_bucket_num_entries(bucket) = kept;
+
+    uint32_t size = 1u << *hash_meta_global_depth(meta);
+    for (uint32_t i = (directory_index & (bit - 1)) | bit; i < size; i += 2 * bit)
+        hash_directory_set_entry(hash_index, i, new_bucket_page_num);
+}
+
+HashIndex *hash_index_open(Pager *pager, uint32_t meta_page_num, uint32_t key_size)
+{
+    HashIndex *hash_index = malloc(sizeof(HashIndex));
+    hash_index->pager = pager;
+    hash_index->meta_page_num = meta_page_num;
+    hash_index->key_size = key_size;
+    hash_index->bucket_entry_size = key_size + sizeof(uint32_t);
+    hash_index->bucket_max_entries = (PAGE_USABLE_SIZE - HASH_BUCKET_HEADER_SIZE) / hash_index->bucket_entry_size;
+    return hash_index;
+}
+
+void hash_index_close(HashIndex *hash_index)
+{
+    free(hash_index);
+}
+
+/*
+    Allocates the meta page, the first directory page and a single bucket (global depth 0),
+    and adds every row of the table. The caller records the new index in the catalog.
+*/
+HashIndex *hash_index_create(Table *table)
+{
+    Pager *pager = table->pager;
+    uint32_t meta_page_num = new_hash_page(pager, NODE_HASH_META);
+    void *meta = get_page_for_write(pager, meta_page_num);
+    set_node_root(meta, true);
+    *hash_meta_global_depth(meta) = 0;
+    *hash_meta_num_directory_pages(meta) = 1;
+    *hash_meta_directory_page(meta, 0) = new_hash_page(pager, NODE_HASH_DIRECTORY);
+
+    HashIndex *hash_index = hash_index_open(pager, meta_page_num, table->layout.key_size);
+    hash_directory_set_entry(hash_index, 0, new_hash_bucket(pager, 0));
+    table->hash_index = hash_index;
+
+    Cursor *cursor = table_start(table);
+    for (; !(cursor->end_of_table); cursor_advance(cursor))
+        hash_index_insert(hash_index, cursor_key(cursor), cursor->page_num);
+    free(cursor);
+
+    return hash_index;
+}
+
+// page number of the leaf holding the given key
+bool hash_index_find(HashIndex *hash_index, const void *key, uint32_t *page_num)
+{
+    void *bucket = hash_bucket_for(hash_index, key, false);
+    uint32_t num_entries = *hash_bucket_num_entries(bucket);
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        if (memcmp(hash_bucket_entry_key(hash_index, bucket, i), key, hash_index->key_size) == 0)
+        {
+            *page_num = *hash_bucket_entry_page(hash_index, bucket, i);
+            return true;
+        }
+    }
+    return false;
+}
+
+void hash_index_insert(HashIndex *hash_index, const void *key, uint32_t page_num)
+{
+    void *bucket = hash_bucket_for(hash_index, key, true);
+    // a split can leave every entry on the same side, in which case we split again
+    while (*hash_bucket_num_entries(bucket) >= hash_index->bucket_max_entries)
+    {
+        hash_bucket_split(hash_index, hash_directory_index(hash_index, key));
+        bucket = hash_bucket_for(hash_index, key, true);
+    }
+
+    uint32_t entry_num = (*hash_bucket_num_entries(bucket))++;
+    memcpy(hash_bucket_entry_key(hash_index, bucket, entry_num), key, hash_index->key_size);
+    *hash_bucket_entry_page(hash_index, bucket, entry_num) = page_num;
+}
+
+// called by the btree when the row with this key moves to another leaf
+void hash_index_set_page(HashIndex *hash_index, const void *key, uint32_t page_num)
+{
+    void *bucket = hash_bucket_for(hash_index, key, true);
+    uint32_t num_entries = *hash_bucket_num_entries(bucket);
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        if (memcmp(hash_bucket_entry_key(hash_index, bucket, i), key, hash_index->key_size) == 0)
+        {
+            *hash_bucket_entry_page(hash_index, bucket, i) = page_num;
+            return;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+
+#ifndef HASH_INDEX_HEADER
+#define HASH_INDEX_HEADER
+
+/*
+  Persistent extendible hash index over the primary keys, for point lookups that would otherwise
+  descend the whole table btree. It maps an encoded key to the page number of the leaf holding the row,
+  so a lookup reads the directory, one bucket and then goes straight to the leaf.
+  • the meta page holds the global depth and the list of directory pages
+  • the directory is an array of 2^global_depth bucket page numbers, spread over as many pages as needed
+  • a bucket holds (key, leaf page number) entries and has a local depth. When it overflows it splits
+    in two, and the directory doubles if the bucket was already pointed to by a single entry.
+  The leaf page of a row changes when its leaf splits, the btree updates the index then.
+*/
+struct HashIndex
+{
+  Pager *pager;
+  uint32_t meta_page_num;
+  uint32_t key_size;
+  uint32_t bucket_entry_size;
+  uint32_t bucket_max_entries;
+};
+
+HashIndex *hash_index_open(Pager *pager, uint32_t meta_page_num, uint32_t key_size);
+HashIndex *hash_index_create(Table *table);
+void hash_index_close(HashIndex *hash_index);
+
+bool hash_index_find(HashIndex *hash_index, const void *key, uint32_t *page_num);
+void hash_index_insert(HashIndex *hash_index, const void *key, uint32_t page_num);
+void hash_index_set_page(HashIndex *hash_index, const void *key, uint32_t page_num);
+
+#endif
@@ -0,0 +1,223 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "index.h"
+
+// bytes taken by an included column in the value of the index
+static uint32_t included_column_size(ColumnDescriptor *descriptor)
+{
+    if (column_type_is_variable(descriptor->type))
+        return RECORD_OFFSET_SIZE + descriptor->size;
+    return descriptor->size;
+}
+
+// bytes taken by the indexed column at the start of the key
+static uint32_t index_column_key_size(Index *index)
+{
+    ColumnDescriptor *descriptor = &(index->record_layout->columns[index->column]);
+    return key_column_size(descriptor->type, descriptor->size);
+}
+
+static NodeLayout index_node_layout(RecordLayout *record_layout, uint32_t column, uint32_t included_columns)
+{
+    uint32_t value_size = record_layout->key_size;
+    for (uint32_t c = 0; c < record_layout->num_columns; c++)
+    {
+        if (included_columns & COLUMN_BIT(c))
+            value_size += included_column_size(&(record_layout->columns[c]));
+    }
+    ColumnDescriptor *descriptor = &(record_layout->columns[column]);
+    return make_node_layout(key_column_size(descriptor->type, descriptor->size) + record_layout->key_size,
+                            value_size);
+}
+
+Index *index_open(Pager *pager, RecordLayout *record_layout, uint32_t column, uint32_t included_columns,
+                  uint32_t root_page_num)
+{
+    Index *index = malloc(sizeof(Index));
+    index->column = column;
+    index->included_columns = included_columns;
+    index->record_layout = record_layout;
+    index->tree = table_new(pager, root_page_num, index_node_layout(record_layout, column, included_columns));
+    return index;
+}
+
+void index_close(Index *index)
+{
+    free(index->tree);
+    free(index);
+}
+
+Index *table_find_index(Table *table, uint32_t column)
+{
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+    {
+        if (table->indexes[i]->column == column)
+            return table->indexes[i];
+    }
+    return NULL;
+}
+
+/*
+    Allocates a root page for the index and fills it with the rows already in the table.
+    The caller records the new index in the catalog.
+    Returns NULL if the table has no room for another index.
+*/
+Index *index_create(Table *table, uint32_t column, uint32_t included_columns)
+{
+    Pager *pager = table->pager;
+    if (table->num_indexes >= TABLE_MAX_INDEXES)
+        return NULL;
+
+    uint32_t root_page_num = get_unused_page_num(pager);
+    void *root_node = get_page_for_write(pager, root_page_num);
+    initialize_leaf_node(root_node);
+    set_node_root(root_node, true);
+
+    Index *index = index_open(pager, &(table->record_layout), column, included_columns, root_page_num);
+    table->indexes[table->num_indexes++] = index;
+
+    Cursor *cursor = table_start(table);
+    while (!(cursor->end_of_table))
+    {
+        index_insert_record(index, cursor_value(cursor));
+        cursor_advance(cursor);
+    }
+    free(cursor);
+
+    return index;
+}
+
+// Encoded column value followed by the encoded primary key.
+// Without primary key (NULL), the smallest key for this value: all the bytes of the primary key are 0.
+void index_build_key(Index *index, const void *value, uint32_t length, const void *primary_key, void *key)
+{
+    ColumnDescriptor *descriptor = &(index->record_layout->columns[index->column]);
+    key_encode_value(descriptor->type, descriptor->size, value, length, key);
+
+    void *primary_key_bytes = key + index_column_key_size(index);
+    if (primary_key == NULL)
+        memset(primary_key_bytes, 0, index->record_layout->key_size);
+    else
+        memcpy(primary_key_bytes, primary_key, index->record_layout->key_size);
+}
+
+void index_insert_record(Index *index, void *record)
+{
+    RecordLayout *record_layout = index->record_layout;
+    uint32_t length;
+    void *column_value;
+
+    uint8_t value[index->tree->layout.value_size];
+    memset(value, 0, index->tree->layout.value_size);
+    record_build_key(record_layout, record, value);
+
+    uint8_t key[index->tree->layout.key_size];
+    column_value = record_column(record_layout, record, index->column, &length);
+    index_build_key(index, column_value, length, value, key);
+
+    uint8_t *included_value = value + record_layout->key_size;
+    for (uint32_t c = 0; c < record_layout->num_columns; c++)
+    {
+        if (!(index->included_columns & COLUMN_BIT(c)))
+            continue;
+        ColumnDescriptor *descriptor = &(record_layout->columns[c]);
+        column_value = record_column(record_layout, record, c, &length);
+        if (column_type_is_variable(descriptor->type))
+            *(uint16_t *)included_value = length;
+        memcpy(included_value + included_column_size(descriptor) - descriptor->size, column_value, length);
+        included_value += included_column_size(descriptor);
+    }
+
+    Cursor *cursor = tree_find(index->tree, key);
+    leaf_node_insert(cursor, key, value);
+    free(cursor);
+}
+
+// first entry whose value is >= the given value, (value, 0) being the smallest key for it
+Cursor *index_seek(Index *index, const void *value, uint32_t length)
+{
+    uint8_t key[index->tree->layout.key_size];
+    index_build_key(index, value, length, NULL, key);
+    return tree_seek(index->tree, key);
+}
+
+// Does the entry under the cursor have this exact value (or start with it).
+// Prefixes are only used on text, whose encoding is the text itself.
+bool index_cursor_matches(Index *index, Cursor *cursor, const void *value, uint32_t length, bool prefix)
+{
+    if (cursor->end_of_table)
+        return false;
+    if (prefix)
+        return memcmp(cursor_key(cursor), value, length) == 0;
+
+    ColumnDescriptor *descriptor = &(index->record_layout->columns[index->column]);
+    uint8_t encoded[index_column_key_size(index)];
+    key_encode_value(descriptor->type, descriptor->size, value, length, encoded);
+    return memcmp(cursor_key(cursor), encoded, index_column_key_size(index)) == 0;
+}
+
+// encoded primary key of the row of the entry under the cursor
+void *index_cursor_primary_key(Cursor *cursor)
+{
+    return cursor_value(cursor);
+}
+
+// can the given set of columns be read from the index entries only
+bool index_covers(Index *index, uint32_t columns)
+{
+    uint32_t available = COLUMN_BIT(index->column) | index->included_columns;
+    for (uint32_t i = 0; i < index->record_layout->num_key_columns; i++)
+        available |= COLUMN_BIT(index->record_layout->key_columns[i]);
+    return (columns & ~available) == 0;
+}
+
+// Rebuilds a record of the table with the covered columns of the entry under the cursor.
+// Columns that are not covered by the index are left empty.
+void index_cursor_record(Index *index, Cursor *cursor, void *record)
+{
+    RecordLayout *record_layout = index->record_layout;
+    uint8_t zeros[RECORD_MAX_SIZE];
+    uint8_t decoded[2 * RECORD_MAX_SIZE]; /* the indexed column can also be part of the primary key */
+    uint8_t *decoded_value = decoded;
+    void *values[TABLE_MAX_COLUMNS];
+    uint32_t lengths[TABLE_MAX_COLUMNS];
+    memset(zeros, 0, RECORD_MAX_SIZE);
+    for (uint32_t c = 0; c < record_layout->num_columns; c++)
+    {
+        values[c] = zeros;
+        lengths[c] = 0;
+    }
+
+    // the indexed column and the primary key are decoded from their encodings
+    uint8_t *key = cursor_key(cursor);
+    ColumnDescriptor *descriptor = &(record_layout->columns[index->column]);
+    values[index->column] = decoded_value;
+    lengths[index->column] = key_decode_value(descriptor->type, key, decoded_value);
+    decoded_value += descriptor->size;
+
+    uint8_t *value = cursor_value(cursor);
+    for (uint32_t i = 0; i < record_layout->num_key_columns; i++)
+    {
+        uint32_t c = record_layout->key_columns[i];
+        descriptor = &(record_layout->columns[c]);
+        values[c] = decoded_value;
+        lengths[c] = key_decode_value(descriptor->type, value, decoded_value);
+        decoded_value += descriptor->size;
+        value += key_column_size(descriptor->type, descriptor->size);
+    }
+
+    for (uint32_t c = 0; c < record_layout->num_columns; c++)
+    {
+        if (!(index->included_columns & COLUMN_BIT(c)))
+            continue;
+        descriptor = &(record_layout->columns[c]);
+        values[c] = value + included_column_size(descriptor) - descriptor->size;
+        if (column_type_is_variable(descriptor->type))
+            lengths[c] = *(uint16_t *)value;
+        value += included_column_size(descriptor);
+    }
+
+    record_pack(record_layout, values, lengths, record);
+}
@@ -0,0 +1,43 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+
+#ifndef INDEX_HEADER
+#define INDEX_HEADER
+
+/*
+  A secondary index is just another btree living in the same file, built with the same
+  node code as the table. Its keys are the encoded indexed column followed by the encoded
+  primary key of the row (see record.h) so that:
+  • duplicate values are allowed (the primary key makes every key unique)
+  • memcmp orders the keys by value first and then by primary key
+  • the encoded text of a prefix is a prefix of the encoded text of the values starting with it
+  The value of every cell is the encoded primary key, used to fetch the row from the table,
+  followed by the included columns (if any, variable width ones behind their 16 bits length).
+  A query that only needs the primary key, the indexed column and the included columns is
+  answered from the index alone, without going back to the table.
+*/
+struct Index
+{
+  uint32_t column;
+  uint32_t included_columns;   /* COLUMN_BIT set, stored in column order after the id */
+  RecordLayout *record_layout; /* records of the indexed table */
+  Table *tree;
+};
+
+Index *index_open(Pager *pager, RecordLayout *record_layout, uint32_t column, uint32_t included_columns,
+                  uint32_t root_page_num);
+Index *index_create(Table *table, uint32_t column, uint32_t included_columns);
+void index_close(Index *index);
+Index *table_find_index(Table *table, uint32_t column);
+
+void index_build_key(Index *index, const void *value, uint32_t length, const void *primary_key, void *key);
+void index_insert_record(Index *index, void *record);
+Cursor *index_seek(Index *index, const void *value, uint32_t length);
+bool index_cursor_matches(Index *index, Cursor *cursor, const void *value, uint32_t length, bool prefix);
+void *index_cursor_primary_key(Cursor *cursor);
+bool index_covers(Index *index, uint32_t columns);
+void index_cursor_record(Index *index, Cursor *cursor, void *record);
+
+#endif
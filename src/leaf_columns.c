@@ -0,0 +1,111 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "leaf_columns.h"
+
+// Minipage Slot Layout
+/* text and blobs: the length of the value, then the value padded to the maximum length */
+const uint32_t MINIPAGE_LENGTH_SIZE = sizeof(uint16_t);
+
+static uint32_t minipage_slot_size(ColumnDescriptor *descriptor)
+{
+    if (column_type_is_variable(descriptor->type))
+        return MINIPAGE_LENGTH_SIZE + descriptor->size;
+    return descriptor->size;
+}
+
+static uint8_t *minipage_slot(Table *table, void *node, uint32_t cell_num, uint32_t column)
+{
+    ColumnDescriptor *descriptor = &(table->record_layout.columns[column]);
+    return (uint8_t *)node + table->minipage_offsets[column] + cell_num * minipage_slot_size(descriptor);
+}
+
+// Sizes the leaves of the table from the slots of a row and places the minipages after the keys
+void columnar_leaf_compile(Table *table)
+{
+    RecordLayout *record_layout = &(table->record_layout);
+    NodeLayout *layout = &(table->layout);
+    uint32_t row_size = layout->key_size;
+    for (uint32_t i = 0; i < record_layout->num_columns; i++)
+        row_size += minipage_slot_size(&(record_layout->columns[i]));
+
+    layout->leaf_cell_size = row_size;
+    layout->leaf_max_cells = LEAF_NODE_SPACE_FOR_CELLS / row_size;
+    layout->leaf_right_split_count = (layout->leaf_max_cells + 1) / 2;
+    layout->leaf_left_split_count = (layout->leaf_max_cells + 1) - layout->leaf_right_split_count;
+
+    uint32_t offset = LEAF_NODE_HEADER_SIZE + layout->leaf_max_cells * layout->key_size;
+    for (uint32_t i = 0; i < record_layout->num_columns; i++)
+    {
+        table->minipage_offsets[i] = offset;
+        offset += layout->leaf_max_cells * minipage_slot_size(&(record_layout->columns[i]));
+    }
+}
+
+void *columnar_leaf_key(Table *table, void *node, uint32_t cell_num)
+{
+    return node + LEAF_NODE_HEADER_SIZE + cell_num * table->layout.key_size;
+}
+
+// Pointer to the value of a column straight in its minipage, its number of bytes is stored in length
+void *columnar_leaf_column(Table *table, void *node, uint32_t cell_num, uint32_t column, uint32_t *length)
+{
+    ColumnDescriptor *descriptor = &(table->record_layout.columns[column]);
+    uint8_t *slot = minipage_slot(table, node, cell_num, column);
+    if (!column_type_is_variable(descriptor->type))
+    {
+        *length = descriptor->size;
+        return slot;
+    }
+    uint16_t slot_length;
+    memcpy(&slot_length, slot, MINIPAGE_LENGTH_SIZE);
+    *length = slot_length;
+    return slot + MINIPAGE_LENGTH_SIZE;
+}
+
+// Gathers the columns of a row from the minipages into a record
+void columnar_leaf_record(Table *table, void *node, uint32_t cell_num, void *record)
+{
+    RecordLayout *layout = &(table->record_layout);
+    void *values[TABLE_MAX_COLUMNS];
+    uint32_t lengths[TABLE_MAX_COLUMNS];
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+        values[i] = columnar_leaf_column(table, node, cell_num, i, &lengths[i]);
+    record_pack(layout, values, lengths, record);
+}
+
+// Scatters the key and the columns of a record in the slots of a row
+void columnar_leaf_write(Table *table, void *node, uint32_t cell_num, const void *key, const void *record)
+{
+    RecordLayout *layout = &(table->record_layout);
+    memcpy(columnar_leaf_key(table, node, cell_num), key, table->layout.key_size);
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+    {
+        uint32_t length;
+        void *value = record_column(layout, (void *)record, i, &length);
+        uint8_t *slot = minipage_slot(table, node, cell_num, i);
+        if (column_type_is_variable(layout->columns[i].type))
+        {
+            // the padding is zeroed like the unused bytes of a cell
+            uint16_t slot_length = length;
+            memcpy(slot, &slot_length, MINIPAGE_LENGTH_SIZE);
+            slot += MINIPAGE_LENGTH_SIZE;
+            memset(slot + length, 0, layout->columns[i].size - length);
+        }
+        memcpy(slot, value, length);
+    }
+}
+
+// Copies a row from a slot to another, in every minipage. The leaves can be the same.
+void columnar_leaf_copy(Table *table, void *destination, uint32_t destination_num, void *source,
+                        uint32_t source_num)
+{
+    RecordLayout *layout = &(table->record_layout);
+    memcpy(columnar_leaf_key(table, destination, destination_num), columnar_leaf_key(table, source, source_num),
+           table->layout.key_size);
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+    {
+        memcpy(minipage_slot(table, destination, destination_num, i), minipage_slot(table, source, source_num, i),
+               minipage_slot_size(&(layout->columns[i])));
+    }
+}
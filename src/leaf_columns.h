@@ -0,0 +1,32 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+
+#ifndef LEAF_COLUMNS_HEADER
+#define LEAF_COLUMNS_HEADER
+
+/*
+  Columnar leaves (PAX), for the tables created with "create columnar table". A leaf holds the
+  same rows as a row leaf would, but every column gets its own minipage: all the ids, then all
+  the usernames, then all the emails. A scan reading one column only touches its minipage, and a
+  predicate runs down a plain array.
+  Layout: header | keys | minipage of column 0 | minipage of column 1 | ...
+  • the keys are kept as they are, the leaf is searched with memcmp like a row leaf
+  • a number takes its width in its minipage
+  • text and blobs take a 16 bits length followed by room for their maximum length
+  Every slot has a fixed size, so the number of rows of a leaf is fixed too and the minipages
+  start at offsets compiled once per table.
+*/
+
+void columnar_leaf_compile(Table *table);
+
+void *columnar_leaf_key(Table *table, void *node, uint32_t cell_num);
+void *columnar_leaf_column(Table *table, void *node, uint32_t cell_num, uint32_t column, uint32_t *length);
+void columnar_leaf_record(Table *table, void *node, uint32_t cell_num, void *record);
+
+void columnar_leaf_write(Table *table, void *node, uint32_t cell_num, const void *key, const void *record);
+void columnar_leaf_copy(Table *table, void *destination, uint32_t destination_num, void *source,
+                        uint32_t source_num);
+
+#endif
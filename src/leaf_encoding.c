@@ -0,0 +1,431 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "leaf_encoding.h"
+
+// Column Block Layouts
+/* integers: base (minimum of the leaf), width of the differences, then the difference of every row */
+const uint32_t FRAME_BASE_OFFSET = 0;
+const uint32_t FRAME_WIDTH_OFFSET = sizeof(int64_t);
+const uint32_t FRAME_HEADER_SIZE = sizeof(int64_t) + sizeof(uint8_t);
+/* text and blobs: number of distinct values, width of the codes, the code of every row,
+   then where every distinct value ends (from the start of the values) and the values back to back */
+const uint32_t DICTIONARY_NUM_ENTRIES_OFFSET = 0;
+const uint32_t DICTIONARY_WIDTH_OFFSET = sizeof(uint16_t);
+const uint32_t DICTIONARY_HEADER_SIZE = sizeof(uint16_t) + sizeof(uint8_t);
+const uint32_t DICTIONARY_END_SIZE = sizeof(uint16_t);
+
+// Open addressing table used to find the distinct values of a column,
+// keys take at least 4 bytes so it is always less than half full.
+#define DICTIONARY_HASH_SIZE 2048
+
+static uint16_t *column_blocks(void *node)
+{
+    return node + LEAF_NODE_HEADER_SIZE;
+}
+
+static uint32_t keys_offset(Table *table)
+{
+    return LEAF_NODE_HEADER_SIZE + table->record_layout.num_columns * sizeof(uint16_t);
+}
+
+void *encoded_leaf_key(Table *table, void *node, uint32_t cell_num)
+{
+    return node + keys_offset(table) + cell_num * table->layout.key_size;
+}
+
+static void write_little_endian(uint64_t value, uint32_t width, uint8_t *destination)
+{
+    for (uint32_t i = 0; i < width; i++)
+        destination[i] = value >> (8 * i);
+}
+
+static uint64_t read_little_endian(const uint8_t *source, uint32_t width)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < width; i++)
+        value |= (uint64_t)source[i] << (8 * i);
+    return value;
+}
+
+// offset of a column in the primary key, -1 if it isn't part of it
+static int32_t key_column_offset(RecordLayout *layout, uint32_t column)
+{
+    uint32_t offset = 0;
+    for (uint32_t i = 0; i < layout->num_key_columns; i++)
+    {
+        ColumnDescriptor *descriptor = &(layout->columns[layout->key_columns[i]]);
+        if (layout->key_columns[i] == column)
+            return offset;
+        offset += key_column_size(descriptor->type, descriptor->size);
+    }
+    return -1;
+}
+
+static int64_t integer_value(ColumnType type, const void *value)
+{
+    int32_t int32;
+    int64_t int64;
+    if (type == COLUMN_TYPE_INT32)
+    {
+        memcpy(&int32, value, sizeof(int32_t));
+        return int32;
+    }
+    memcpy(&int64, value, sizeof(int64_t));
+    return int64;
+}
+
+// smallest number of bytes holding the differences with the base
+static uint32_t frame_width(uint64_t range)
+{
+    if (range == 0)
+        return 0;
+    if (range <= 0xFF)
+        return 1;
+    if (range <= 0xFFFF)
+        return 2;
+    if (range <= 0xFFFFFFFF)
+        return 4;
+    return 8;
+}
+
+/*
+    The encoders return the size of the block of a column and only write it when it fits in capacity.
+    The records of the rows are max_size apart.
+*/
+static uint32_t encode_integers(RecordLayout *layout, uint32_t column, uint8_t *records, uint32_t count,
+                                uint8_t *block, uint32_t capacity)
+{
+    ColumnType type = layout->columns[column].type;
+    uint32_t length;
+    int64_t min = 0, max = 0;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int64_t value = integer_value(type, record_column(layout, records + i * layout->max_size, column, &length));
+        if (i == 0 || value < min)
+            min = value;
+        if (i == 0 || value > max)
+            max = value;
+    }
+    uint32_t width = frame_width((uint64_t)max - (uint64_t)min);
+    uint32_t size = FRAME_HEADER_SIZE + count * width;
+    if (size > capacity)
+        return size;
+
+    memcpy(block + FRAME_BASE_OFFSET, &min, sizeof(int64_t));
+    block[FRAME_WIDTH_OFFSET] = width;
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int64_t value = integer_value(type, record_column(layout, records + i * layout->max_size, column, &length));
+        write_little_endian((uint64_t)value - (uint64_t)min, width, block + FRAME_HEADER_SIZE + i * width);
+    }
+    return size;
+}
+
+static uint32_t encode_doubles(RecordLayout *layout, uint32_t column, uint8_t *records, uint32_t count,
+                               uint8_t *block, uint32_t capacity)
+{
+    uint32_t length;
+    uint32_t size = count * sizeof(double);
+    if (size > capacity)
+        return size;
+    for (uint32_t i = 0; i < count; i++)
+        memcpy(block + i * sizeof(double), record_column(layout, records + i * layout->max_size, column, &length),
+               sizeof(double));
+    return size;
+}
+
+static uint32_t hash_bytes(const uint8_t *bytes, uint32_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++)
+        hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
+
+static uint32_t encode_dictionary(RecordLayout *layout, uint32_t column, uint8_t *records, uint32_t count,
+                                  uint8_t *block, uint32_t capacity)
+{
+    int32_t slots[DICTIONARY_HASH_SIZE];
+    memset(slots, -1, sizeof(slots));
+    uint8_t **values = malloc(count * sizeof(uint8_t *));
+    uint32_t *lengths = malloc(count * sizeof(uint32_t));
+    uint32_t *codes = malloc(count * sizeof(uint32_t));
+    uint32_t num_entries = 0, values_size = 0;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint32_t length;
+        uint8_t *value = record_column(layout, records + i * layout->max_size, column, &length);
+        uint32_t slot = hash_bytes(value, length) & (DICTIONARY_HASH_SIZE - 1);
+        while (slots[slot] >= 0 &&
+               !(lengths[slots[slot]] == length && memcmp(values[slots[slot]], value, length) == 0))
+            slot = (slot + 1) & (DICTIONARY_HASH_SIZE - 1);
+        if (slots[slot] < 0)
+        {
+            slots[slot] = num_entries;
+            values[num_entries] = value;
+            lengths[num_entries++] = length;
+            values_size += length;
+        }
+        codes[i] = slots[slot];
+    }
+
+    uint32_t width = num_entries <= 256 ? 1 : 2;
+    uint32_t ends_offset = DICTIONARY_HEADER_SIZE + count * width;
+    uint32_t values_offset = ends_offset + num_entries * DICTIONARY_END_SIZE;
+    uint32_t size = values_offset + values_size;
+    if (size <= capacity)
+    {
+        uint16_t num_entries_16 = num_entries, end = 0;
+        memcpy(block + DICTIONARY_NUM_ENTRIES_OFFSET, &num_entries_16, sizeof(uint16_t));
+        block[DICTIONARY_WIDTH_OFFSET] = width;
+        for (uint32_t i = 0; i < count; i++)
+            write_little_endian(codes[i], width, block + DICTIONARY_HEADER_SIZE + i * width);
+        for (uint32_t i = 0; i < num_entries; i++)
+        {
+            memcpy(block + values_offset + end, values[i], lengths[i]);
+            end += lengths[i];
+            memcpy(block + ends_offset + i * DICTIONARY_END_SIZE, &end, sizeof(uint16_t));
+        }
+    }
+    free(values);
+    free(lengths);
+    free(codes);
+    return size;
+}
+
+static uint32_t dictionary_code(uint8_t *block, uint32_t cell_num)
+{
+    uint32_t width = block[DICTIONARY_WIDTH_OFFSET];
+    return read_little_endian(block + DICTIONARY_HEADER_SIZE + cell_num * width, width);
+}
+
+static uint32_t dictionary_num_entries(uint8_t *block)
+{
+    uint16_t num_entries;
+    memcpy(&num_entries, block + DICTIONARY_NUM_ENTRIES_OFFSET, sizeof(uint16_t));
+    return num_entries;
+}
+
+// bytes of the distinct value with the given code
+static void *dictionary_entry(uint8_t *block, uint32_t num_cells, uint32_t code, uint32_t *length)
+{
+    uint8_t *ends = block + DICTIONARY_HEADER_SIZE + num_cells * block[DICTIONARY_WIDTH_OFFSET];
+    uint8_t *values = ends + dictionary_num_entries(block) * DICTIONARY_END_SIZE;
+    uint16_t start = 0, end;
+    if (code > 0)
+        memcpy(&start, ends + (code - 1) * DICTIONARY_END_SIZE, sizeof(uint16_t));
+    memcpy(&end, ends + code * DICTIONARY_END_SIZE, sizeof(uint16_t));
+    *length = end - start;
+    return values + start;
+}
+
+// Rebuilds the record of a row from the key and the blocks of its columns
+void encoded_leaf_record(Table *table, void *node, uint32_t cell_num, void *record)
+{
+    RecordLayout *layout = &(table->record_layout);
+    uint16_t *blocks = column_blocks(node);
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint8_t *key = encoded_leaf_key(table, node, cell_num);
+    void *values[TABLE_MAX_COLUMNS];
+    uint32_t lengths[TABLE_MAX_COLUMNS];
+    int64_t integers[TABLE_MAX_COLUMNS];
+    uint8_t key_values[KEY_MAX_SIZE];
+    uint32_t key_values_size = 0;
+
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+    {
+        ColumnDescriptor *descriptor = &(layout->columns[i]);
+        uint8_t *block = (uint8_t *)node + blocks[i];
+        int32_t key_offset = key_column_offset(layout, i);
+        if (key_offset >= 0)
+        {
+            values[i] = key_values + key_values_size;
+            lengths[i] = key_decode_value(descriptor->type, key + key_offset, values[i]);
+            key_values_size += lengths[i];
+            continue;
+        }
+
+        int64_t base;
+        int32_t int32;
+        uint32_t width;
+        switch (descriptor->type)
+        {
+        case (COLUMN_TYPE_INT32):
+        case (COLUMN_TYPE_INT64):
+            memcpy(&base, block + FRAME_BASE_OFFSET, sizeof(int64_t));
+            width = block[FRAME_WIDTH_OFFSET];
+            integers[i] = (int64_t)((uint64_t)base +
+                                    read_little_endian(block + FRAME_HEADER_SIZE + cell_num * width, width));
+            if (descriptor->type == COLUMN_TYPE_INT32)
+            {
+                int32 = integers[i];
+                memcpy(&integers[i], &int32, sizeof(int32_t));
+            }
+            values[i] = &integers[i];
+            break;
+        case (COLUMN_TYPE_DOUBLE):
+            values[i] = block + cell_num * sizeof(double);
+            break;
+        case (COLUMN_TYPE_TEXT):
+        case (COLUMN_TYPE_BLOB):
+            values[i] = dictionary_entry(block, num_cells, dictionary_code(block, cell_num), &lengths[i]);
+            break;
+        }
+    }
+    record_pack(layout, values, lengths, record);
+}
+
+// Decodes every row of the leaf, with room for one more
+LeafRows *encoded_leaf_read(Table *table, void *node)
+{
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint32_t key_size = table->layout.key_size;
+    uint32_t record_size = table->record_layout.max_size;
+    LeafRows *rows = malloc(sizeof(LeafRows));
+    rows->num_rows = num_cells;
+    rows->keys = malloc((num_cells + 1) * key_size);
+    rows->records = malloc((num_cells + 1) * record_size);
+    memcpy(rows->keys, encoded_leaf_key(table, node, 0), num_cells * key_size);
+    for (uint32_t i = 0; i < num_cells; i++)
+        encoded_leaf_record(table, node, i, rows->records + i * record_size);
+    return rows;
+}
+
+void leaf_rows_insert(Table *table, LeafRows *rows, uint32_t position, const void *key, const void *record)
+{
+    uint32_t key_size = table->layout.key_size;
+    uint32_t record_size = table->record_layout.max_size;
+    uint32_t num_moved = rows->num_rows - position;
+    memmove(rows->keys + (position + 1) * key_size, rows->keys + position * key_size, num_moved * key_size);
+    memmove(rows->records + (position + 1) * record_size, rows->records + position * record_size,
+            num_moved * record_size);
+    memcpy(rows->keys + position * key_size, key, key_size);
+    memcpy(rows->records + position * record_size, record, record_size);
+    rows->num_rows++;
+}
+
+void leaf_rows_free(LeafRows *rows)
+{
+    free(rows->keys);
+    free(rows->records);
+    free(rows);
+}
+
+// Encodes the rows [first, first + count) in the leaf.
+// Returns false without touching the leaf if they don't fit in a page.
+bool encoded_leaf_write(Table *table, void *node, LeafRows *rows, uint32_t first, uint32_t count)
+{
+    RecordLayout *layout = &(table->record_layout);
+    uint32_t key_size = table->layout.key_size;
+    uint8_t *records = rows->records + first * layout->max_size;
+    uint8_t *page = malloc(PAGE_SIZE);
+    uint16_t *blocks = column_blocks(page);
+    uint32_t offset = keys_offset(table) + count * key_size;
+    bool fits = offset <= PAGE_USABLE_SIZE && count <= DICTIONARY_HASH_SIZE / 2;
+
+    for (uint32_t i = 0; fits && i < layout->num_columns; i++)
+    {
+        uint32_t size = 0;
+        blocks[i] = 0;
+        if (key_column_offset(layout, i) >= 0)
+            continue;
+        switch (layout->columns[i].type)
+        {
+        case (COLUMN_TYPE_INT32):
+        case (COLUMN_TYPE_INT64):
+            size = encode_integers(layout, i, records, count, page + offset, PAGE_USABLE_SIZE - offset);
+            break;
+        case (COLUMN_TYPE_DOUBLE):
+            size = encode_doubles(layout, i, records, count, page + offset, PAGE_USABLE_SIZE - offset);
+            break;
+        case (COLUMN_TYPE_TEXT):
+        case (COLUMN_TYPE_BLOB):
+            size = encode_dictionary(layout, i, records, count, page + offset, PAGE_USABLE_SIZE - offset);
+            break;
+        }
+        fits = size <= PAGE_USABLE_SIZE - offset;
+        blocks[i] = offset;
+        offset += size;
+    }
+
+    if (fits)
+    {
+        memcpy(page + keys_offset(table), rows->keys + first * key_size, count * key_size);
+        memcpy(node + LEAF_NODE_HEADER_SIZE, page + LEAF_NODE_HEADER_SIZE, offset - LEAF_NODE_HEADER_SIZE);
+        *leaf_node_num_cells(node) = count;
+    }
+    free(page);
+    return fits;
+}
+
+// Can an equality on the column be checked on the dictionary codes
+bool encoded_leaf_has_dictionary(Table *table, uint32_t column)
+{
+    return table->schema.leaf_format == LEAF_FORMAT_ENCODED &&
+           column_type_is_variable(table->record_layout.columns[column].type) &&
+           key_column_offset(&(table->record_layout), column) < 0;
+}
+
+// Code of a value in the dictionary of a column of the leaf, -1 if no row of the leaf has it
+int32_t encoded_leaf_find_code(Table *table, void *node, uint32_t column, const void *value, uint32_t length)
+{
+    uint8_t *block = (uint8_t *)node + column_blocks(node)[column];
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint32_t num_entries = dictionary_num_entries(block);
+    for (uint32_t i = 0; i < num_entries; i++)
+    {
+        uint32_t entry_length;
+        void *entry = dictionary_entry(block, num_cells, i, &entry_length);
+        if (entry_length == length && memcmp(entry, value, length) == 0)
+            return i;
+    }
+    return -1;
+}
+
+uint32_t encoded_leaf_code(Table *table, void *node, uint32_t column, uint32_t cell_num)
+{
+    return dictionary_code((uint8_t *)node + column_blocks(node)[column], cell_num);
+}
+
+// Bytes used by the leaf, up to the end of its last column block
+uint32_t encoded_leaf_size(Table *table, void *node)
+{
+    RecordLayout *layout = &(table->record_layout);
+    uint16_t *blocks = column_blocks(node);
+    uint32_t num_cells = *leaf_node_num_cells(node);
+    uint32_t size = keys_offset(table) + num_cells * table->layout.key_size;
+
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+    {
+        uint8_t *block = (uint8_t *)node + blocks[i];
+        uint32_t end = blocks[i], length;
+        if (blocks[i] == 0)
+            continue;
+        switch (layout->columns[i].type)
+        {
+        case (COLUMN_TYPE_INT32):
+        case (COLUMN_TYPE_INT64):
+            end += FRAME_HEADER_SIZE + num_cells * block[FRAME_WIDTH_OFFSET];
+            break;
+        case (COLUMN_TYPE_DOUBLE):
+            end += num_cells * sizeof(double);
+            break;
+        case (COLUMN_TYPE_TEXT):
+        case (COLUMN_TYPE_BLOB):
+            if (dictionary_num_entries(block) == 0)
+                end += DICTIONARY_HEADER_SIZE;
+            else
+            {
+                uint8_t *entry = dictionary_entry(block, num_cells, dictionary_num_entries(block) - 1, &length);
+                end = entry + length - (uint8_t *)node;
+            }
+            break;
+        }
+        if (end > size)
+            size = end;
+    }
+    return size;
+}
@@ -0,0 +1,46 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "table.h"
+
+#ifndef LEAF_ENCODING_HEADER
+#define LEAF_ENCODING_HEADER
+
+/*
+  Encoded leaves, for the tables created with "create encoded table". Instead of fixed size cells,
+  a leaf stores its rows column by column, each column with the encoding that suits its type:
+  • the keys are kept as they are, one after the other, so the leaf is still searched with memcmp.
+    The primary key columns are decoded from them rather than stored a second time.
+  • integers use frame of reference: the minimum of the leaf, then the difference with it for
+    every row on 0, 1, 2, 4 or 8 bytes (dense ids take a single byte)
+  • text and blobs use a dictionary: the distinct values of the leaf once, then a code per row
+    on 1 or 2 bytes. Equality filters compare the codes instead of the values.
+  • doubles are stored as is
+  Layout: header | offset of every column block (0 for a key column) | keys | column blocks
+  Every array is made of fixed width elements, so a row is decoded without looking at the others.
+  A leaf is modified by decoding its rows, changing them and encoding them again: it holds as many
+  rows as fit in the page rather than a fixed number of cells.
+*/
+
+// the decoded rows of a leaf
+typedef struct
+{
+  uint32_t num_rows;
+  uint8_t *keys;    /* key i starts at i * key_size */
+  uint8_t *records; /* record i starts at i * record max_size */
+} LeafRows;
+
+void *encoded_leaf_key(Table *table, void *node, uint32_t cell_num);
+void encoded_leaf_record(Table *table, void *node, uint32_t cell_num, void *record);
+uint32_t encoded_leaf_size(Table *table, void *node);
+
+LeafRows *encoded_leaf_read(Table *table, void *node);
+void leaf_rows_insert(Table *table, LeafRows *rows, uint32_t position, const void *key, const void *record);
+void leaf_rows_free(LeafRows *rows);
+bool encoded_leaf_write(Table *table, void *node, LeafRows *rows, uint32_t first, uint32_t count);
+
+bool encoded_leaf_has_dictionary(Table *table, uint32_t column);
+int32_t encoded_leaf_find_code(Table *table, void *node, uint32_t column, const void *value, uint32_t length);
+uint32_t encoded_leaf_code(Table *table, void *node, uint32_t column, uint32_t cell_num);
+
+#endif
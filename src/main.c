@@ -5,20 +5,54 @@
 #include "table.h"
 #include "user_input.h"
 #include "codegen.h"
+#include "vfs.h"
 
 int main(int argc, char *argv[])
 {
-    if (argc < 2)
+    // --compress creates a new database file with compressed pages
+    // --vfs <name> picks how the file is stored, --io-latency <us> slows its I/O down (see vfs.h)
+    // :memory: as the filename opens a scratch database, gone on exit (see pager.h)
+    bool compressed = false;
+    Vfs *vfs = vfs_default();
+    uint32_t io_latency_us = 0;
+    int i = 1;
+    for (; i < argc && strncmp(argv[i], "--", 2) == 0; i++)
+    {
+        if (strcmp(argv[i], "--compress") == 0)
+            compressed = true;
+        else if (strcmp(argv[i], "--vfs") == 0 && i + 1 < argc)
+        {
+            vfs = vfs_find(argv[++i]);
+            if (vfs == NULL)
+            {
+                printf("Unknown VFS '%s'.\n", argv[i]);
+                exit(EXIT_FAILURE);
+            }
+        }
+        else if (strcmp(argv[i], "--io-latency") == 0 && i + 1 < argc)
+            io_latency_us = atoi(argv[++i]);
+        else
+        {
+            printf("Unknown option '%s'.\n", argv[i]);
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (i >= argc)
     {
         printf("Must supply a database filename.\n");
         exit(EXIT_FAILURE);
     }
-    char *filename = argv[1];
-    Table *table = db_open(filename);
+    if (io_latency_us > 0)
+        vfs = vfs_latency(vfs, io_latency_us * 1000ULL, io_latency_us * 1000ULL, io_latency_us * 1000ULL);
+    vfs_set_default(vfs);
+    char *filename = argv[i];
+    Database *db = db_open(filename, compressed);
     InputBuffer *input_buffer = new_input_buffer();
 
     while (true)
     {
+        // no page pointer is held between statements, the buffer pool can shrink back to its capacity
+        pager_trim(db->pager);
         print_prompt();
         // read_input uses getLine which will wait for the user input
         read_input(input_buffer);
@@ -26,7 +60,7 @@ int main(int argc, char *argv[])
         // meta commands, (not SQL)
         if (input_buffer->buffer[0] == '.')
         {
-            switch (execute_meta_command(input_buffer, table))
+            switch (execute_meta_command(input_buffer, db))
             {
             case (META_COMMAND_SUCCESS):
                 continue; /* continue while loop */
@@ -38,15 +72,21 @@ int main(int argc, char *argv[])
 
         // "front end": responsible for parsing the entered SQL command
         Statement statement;
-        switch (prepare_statement(input_buffer, &statement))
+        switch (prepare_statement(input_buffer, &statement, db))
         {
         case (PREPARE_SUCCESS):
             break;
         case (PREPARE_STRING_TOO_LONG):
             printf("String is too long.\n");
             continue;
-        case (PREPARE_NEGATIVE_ID):
-            printf("ID must be positive.\n");
+        case (PREPARE_NO_SUCH_TABLE):
+            printf("Error: No such table.\n");
+            continue;
+        case (PREPARE_RECORD_TOO_LARGE):
+            printf("Record is too large.\n");
+            continue;
+        case (PREPARE_KEY_TOO_LARGE):
+            printf("Key is too large.\n");
             continue;
         case (PREPARE_SYNTAX_ERROR):
             printf("Syntax error. Could not parse statement %s \n", input_buffer->buffer);
@@ -57,12 +97,20 @@ int main(int argc, char *argv[])
         }
 
         // "back-end": future VM responsible for handling the command
-        switch (execute_statement(&statement, table))
+        switch (execute_statement(&statement, db))
         {
         case (EXECUTE_SUCCESS):
             printf("Executed.\n");
             break;
-            // case EXECUTE_TABLE_FULL removed since part on splitting leaf node
+        case (EXECUTE_TOO_MANY_INDEXES):
+            printf("Error: Too many indexes.\n");
+            break;
+        case (EXECUTE_INDEX_EXISTS):
+            printf("Error: Index already exists.\n");
+            break;
+        case (EXECUTE_TABLE_EXISTS):
+            printf("Error: Table already exists.\n");
+            break;
         case (EXECUTE_FAILURE):
             printf("Query error.\n");
             break;
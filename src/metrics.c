@@ -0,0 +1,126 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "metrics.h"
+
+// monotonic clock in nanoseconds
+uint64_t metrics_now()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+}
+
+static uint32_t histogram_bucket(uint64_t value)
+{
+    if (value < (2u << HISTOGRAM_SUB_BUCKET_BITS))
+        return value;
+    if (value >> HISTOGRAM_MAX_BITS != 0)
+        return HISTOGRAM_BUCKETS - 1;
+    // value has its highest bit at exponent + HISTOGRAM_SUB_BUCKET_BITS
+    uint32_t exponent = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    return (exponent << HISTOGRAM_SUB_BUCKET_BITS) + (value >> exponent);
+}
+
+// highest value counted in the bucket
+static uint64_t histogram_bucket_value(uint32_t bucket)
+{
+    if (bucket < (2u << HISTOGRAM_SUB_BUCKET_BITS))
+        return bucket;
+    uint32_t exponent = (bucket >> HISTOGRAM_SUB_BUCKET_BITS) - 1;
+    uint64_t lowest = (uint64_t)(bucket - (exponent << HISTOGRAM_SUB_BUCKET_BITS)) << exponent;
+    return lowest + (1ull << exponent) - 1;
+}
+
+void histogram_record(Histogram *histogram, uint64_t value)
+{
+    histogram->buckets[histogram_bucket(value)]++;
+    histogram->count++;
+    if (value > histogram->max)
+        histogram->max = value;
+}
+
+// percentile in [0, 100], 0 if nothing was recorded
+uint64_t histogram_percentile(Histogram *histogram, double percentile)
+{
+    uint64_t rank = percentile / 100 * histogram->count + 0.5;
+    uint64_t seen = 0;
+    if (rank == 0)
+        rank = 1;
+    for (uint32_t i = 0; i < HISTOGRAM_BUCKETS && histogram->count > 0; i++)
+    {
+        seen += histogram->buckets[i];
+        if (seen >= rank)
+        {
+            uint64_t value = histogram_bucket_value(i);
+            return value < histogram->max ? value : histogram->max;
+        }
+    }
+    return 0;
+}
+
+Metrics *metrics_new()
+{
+    // the slow log starts disabled
+    return calloc(1, sizeof(Metrics));
+}
+
+// forgets the latencies and the slow statements, the slow log settings stay
+void metrics_reset(Metrics *metrics)
+{
+    bool enabled = metrics->slow_log_enabled;
+    uint64_t threshold = metrics->slow_threshold_ns;
+    memset(metrics, 0, sizeof(Metrics));
+    metrics->slow_log_enabled = enabled;
+    metrics->slow_threshold_ns = threshold;
+}
+
+// Takes the place of the oldest entry once the log is full, the caller fills in the measures
+SlowLogEntry *slow_log_append(Metrics *metrics, const char *text)
+{
+    SlowLogEntry *entry = &(metrics->slow_log[metrics->slow_log_next]);
+    metrics->slow_log_next = (metrics->slow_log_next + 1) % SLOW_LOG_SIZE;
+    if (metrics->slow_log_count < SLOW_LOG_SIZE)
+        metrics->slow_log_count++;
+    strncpy(entry->text, text, SLOW_LOG_TEXT_SIZE);
+    entry->text[SLOW_LOG_TEXT_SIZE] = 0;
+    return entry;
+}
+
+static void print_histogram(const char *type_name, const char *phase, Histogram *histogram)
+{
+    printf("%-18s %-8s %8lu %10.1f %10.1f %10.1f %10.1f %10.1f\n", type_name, phase,
+           (unsigned long)histogram->count, histogram_percentile(histogram, 50) / 1e3,
+           histogram_percentile(histogram, 90) / 1e3, histogram_percentile(histogram, 99) / 1e3,
+           histogram_percentile(histogram, 99.9) / 1e3, histogram->max / 1e3);
+}
+
+// one line per statement type and phase that ran at least once, in microseconds
+void print_latencies(Metrics *metrics, const char **type_names, uint32_t num_types)
+{
+    printf("%-18s %-8s %8s %10s %10s %10s %10s %10s\n", "statement", "phase", "count", "p50 us", "p90 us",
+           "p99 us", "p99.9 us", "max us");
+    for (uint32_t i = 0; i < num_types && i < METRICS_STATEMENT_TYPES; i++)
+    {
+        if (metrics->prepare[i].count > 0)
+            print_histogram(type_names[i], "prepare", &(metrics->prepare[i]));
+        if (metrics->execute[i].count > 0)
+            print_histogram(type_names[i], "execute", &(metrics->execute[i]));
+    }
+}
+
+// oldest first
+void print_slow_log(Metrics *metrics)
+{
+    uint32_t first = (metrics->slow_log_next + SLOW_LOG_SIZE - metrics->slow_log_count) % SLOW_LOG_SIZE;
+    for (uint32_t i = 0; i < metrics->slow_log_count; i++)
+    {
+        SlowLogEntry *entry = &(metrics->slow_log[(first + i) % SLOW_LOG_SIZE]);
+        printf("%.1f us: %s\n", (entry->prepare_ns + entry->execute_ns) / 1e3, entry->text);
+        printf("  prepare %.1f us, execute %.1f us, plan: %s, pages: %lu hits, %lu misses\n",
+               entry->prepare_ns / 1e3, entry->execute_ns / 1e3, entry->plan, (unsigned long)entry->page_hits,
+               (unsigned long)entry->page_misses);
+    }
+}
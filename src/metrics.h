@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef METRICS_HEADER
+#define METRICS_HEADER
+
+/*
+  Latencies of the statements, kept as HDR style histograms: the values below 64 ns get a bucket
+  each, above that every power of two is split into 32 linear buckets, so a recorded value is
+  known within about 3% whatever its magnitude. The buckets cover up to 2^40 ns (about 18 minutes),
+  longer latencies are counted in the last one.
+*/
+#define HISTOGRAM_SUB_BUCKET_BITS 5
+#define HISTOGRAM_MAX_BITS 40
+#define HISTOGRAM_BUCKETS ((HISTOGRAM_MAX_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) << HISTOGRAM_SUB_BUCKET_BITS)
+
+typedef struct
+{
+  uint64_t count;
+  uint64_t max;
+  uint64_t buckets[HISTOGRAM_BUCKETS];
+} Histogram;
+
+// enough for every StatementType
+#define METRICS_STATEMENT_TYPES 8
+// the slow log keeps the latest statements over the threshold
+#define SLOW_LOG_SIZE 32
+#define SLOW_LOG_TEXT_SIZE 128
+
+typedef struct
+{
+  char text[SLOW_LOG_TEXT_SIZE + 1]; /* the statement, truncated */
+  const char *plan;
+  uint64_t prepare_ns;
+  uint64_t execute_ns;
+  uint64_t page_hits;   /* pages found in the buffer pool */
+  uint64_t page_misses; /* pages read from the file */
+} SlowLogEntry;
+
+typedef struct
+{
+  // one histogram per statement type and phase
+  Histogram prepare[METRICS_STATEMENT_TYPES];
+  Histogram execute[METRICS_STATEMENT_TYPES];
+  bool slow_log_enabled;
+  uint64_t slow_threshold_ns; /* on prepare + execute */
+  SlowLogEntry slow_log[SLOW_LOG_SIZE];
+  uint32_t slow_log_next;
+  uint32_t slow_log_count;
+} Metrics;
+
+uint64_t metrics_now();
+void histogram_record(Histogram *histogram, uint64_t value);
+uint64_t histogram_percentile(Histogram *histogram, double percentile);
+Metrics *metrics_new();
+void metrics_reset(Metrics *metrics);
+SlowLogEntry *slow_log_append(Metrics *metrics, const char *text);
+void print_latencies(Metrics *metrics, const char **type_names, uint32_t num_types);
+void print_slow_log(Metrics *metrics);
+
+#endif
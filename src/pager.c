@@ -0,0 +1,838 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include "pager.h"
+#include "compression.h"
+#include "checksum.h"
+#include "trace.h"
+
+// Compressed File Layout
+/*
+    The header sector starts with a magic that differs from the one of page 0 of a plain file,
+    followed by the number of pages and the offset of the page map (num_pages PageExtent).
+*/
+const char COMPRESSED_FILE_MAGIC[] = "sqlite-clone lz";
+const uint32_t COMPRESSED_FILE_MAGIC_SIZE = 16;
+const uint32_t COMPRESSED_FILE_NUM_PAGES_OFFSET = COMPRESSED_FILE_MAGIC_SIZE;
+const uint32_t COMPRESSED_FILE_PAGE_MAP_OFFSET = COMPRESSED_FILE_NUM_PAGES_OFFSET + sizeof(uint32_t);
+const uint32_t COMPRESSED_FILE_SECTOR_SIZE = 256;
+// appended to the name of the database file to get the one of its warm-up list
+const char WARM_FILE_SUFFIX[] = "-warm";
+
+// Page numbers are dense, their lowest bits are enough to spread them across the buckets
+static Frame **page_table_bucket(Pager *pager, uint32_t page_num)
+{
+    return &(pager->page_table[page_num & (pager->num_buckets - 1)]);
+}
+
+static Frame *page_table_find(Pager *pager, uint32_t page_num)
+{
+    Frame *frame = *page_table_bucket(pager, page_num);
+    while (frame != NULL && frame->page_num != page_num)
+        frame = frame->hash_next;
+    return frame;
+}
+
+// keeps about one frame per bucket, the pool can grow past its capacity during a statement
+static void page_table_grow(Pager *pager)
+{
+    Frame **old_table = pager->page_table;
+    uint32_t old_num_buckets = pager->num_buckets;
+
+    pager->num_buckets *= 2;
+    pager->page_table = calloc(pager->num_buckets, sizeof(Frame *));
+    for (uint32_t i = 0; i < old_num_buckets; i++)
+    {
+        Frame *frame = old_table[i];
+        while (frame != NULL)
+        {
+            Frame *next = frame->hash_next;
+            Frame **bucket = page_table_bucket(pager, frame->page_num);
+            frame->hash_next = *bucket;
+            *bucket = frame;
+            frame = next;
+        }
+    }
+    free(old_table);
+}
+
+static void page_table_remove(Pager *pager, Frame *frame)
+{
+    Frame **link = page_table_bucket(pager, frame->page_num);
+    while (*link != frame)
+        link = &((*link)->hash_next);
+    *link = frame->hash_next;
+}
+
+static FrameList *frame_list(Pager *pager, Frame *frame)
+{
+    return frame->in_ring ? &(pager->ring) : &(pager->lru);
+}
+
+static void list_unlink(FrameList *list, Frame *frame)
+{
+    if (frame->lru_prev != NULL)
+        frame->lru_prev->lru_next = frame->lru_next;
+    else
+        list->head = frame->lru_next;
+    if (frame->lru_next != NULL)
+        frame->lru_next->lru_prev = frame->lru_prev;
+    else
+        list->tail = frame->lru_prev;
+    list->length--;
+}
+
+static void list_push_front(FrameList *list, Frame *frame)
+{
+    frame->lru_prev = NULL;
+    frame->lru_next = list->head;
+    if (list->head != NULL)
+        list->head->lru_prev = frame;
+    list->head = frame;
+    if (list->tail == NULL)
+        list->tail = frame;
+    list->length++;
+}
+
+// the page becomes the most recently used of the LRU list, leaving the scan ring if it was in it
+static void lru_promote(Pager *pager, Frame *frame)
+{
+    list_unlink(frame_list(pager, frame), frame);
+    frame->in_ring = false;
+    list_push_front(&(pager->lru), frame);
+}
+
+static void pager_read_at(Pager *pager, uint32_t offset, void *destination, uint32_t size)
+{
+    ssize_t bytes_read = pager->file->methods->read_at(pager->file, offset, destination, size);
+    if (bytes_read == -1)
+    {
+        printf("Error reading file: %d\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    // past the end of the file, the checksum tells whether it was expected
+    if (bytes_read < size)
+        memset(destination + bytes_read, 0, size - bytes_read);
+    pager->stats.reads++;
+    pager->stats.bytes_read += bytes_read;
+}
+
+static void pager_write_at(Pager *pager, uint32_t offset, const void *source, uint32_t size)
+{
+    ssize_t bytes_written = pager->file->methods->write_at(pager->file, offset, source, size);
+    if (bytes_written == -1)
+    {
+        printf("Error writing: %d\n", errno);
+        exit(EXIT_FAILURE);
+    }
+    pager->stats.writes++;
+    pager->stats.bytes_written += bytes_written;
+}
+
+// makes sure the page map has an entry for every page, the new ones are never written
+static void page_map_grow(Pager *pager, uint32_t num_pages)
+{
+    if (num_pages <= pager->page_map_capacity)
+        return;
+    uint32_t capacity = pager->page_map_capacity * 2;
+    if (capacity < num_pages)
+        capacity = num_pages;
+    pager->page_map = realloc(pager->page_map, capacity * sizeof(PageExtent));
+    memset(pager->page_map + pager->page_map_capacity, 0, (capacity - pager->page_map_capacity) * sizeof(PageExtent));
+    pager->committed_extents = realloc(pager->committed_extents, capacity * sizeof(bool));
+    memset(pager->committed_extents + pager->page_map_capacity, 0, (capacity - pager->page_map_capacity) * sizeof(bool));
+    pager->page_map_capacity = capacity;
+}
+
+static void free_extents_add(Pager *pager, uint32_t offset, uint32_t capacity)
+{
+    if (pager->num_free_extents == pager->free_extents_capacity)
+    {
+        pager->free_extents_capacity = pager->free_extents_capacity == 0 ? 16 : pager->free_extents_capacity * 2;
+        pager->free_extents = realloc(pager->free_extents, pager->free_extents_capacity * sizeof(PageExtent));
+    }
+    PageExtent *extent = &(pager->free_extents[pager->num_free_extents++]);
+    extent->offset = offset;
+    extent->length = 0;
+    extent->capacity = capacity;
+}
+
+// First fit among the free extents, otherwise the space is taken at the end of the file
+static uint32_t pager_allocate_extent(Pager *pager, uint32_t capacity)
+{
+    for (uint32_t i = 0; i < pager->num_free_extents; i++)
+    {
+        PageExtent *extent = &(pager->free_extents[i]);
+        if (extent->capacity < capacity)
+            continue;
+        uint32_t offset = extent->offset;
+        extent->offset += capacity;
+        extent->capacity -= capacity;
+        if (extent->capacity == 0)
+            *extent = pager->free_extents[--pager->num_free_extents];
+        return offset;
+    }
+    uint32_t offset = pager->file_length;
+    pager->file_length += capacity;
+    return offset;
+}
+
+static int compare_extent_offsets(const void *a, const void *b)
+{
+    uint32_t offset_a = ((const PageExtent *)a)->offset, offset_b = ((const PageExtent *)b)->offset;
+    return (offset_a > offset_b) - (offset_a < offset_b);
+}
+
+/*
+    Reads the page map of a compressed file. The free extents are not stored: they are the gaps
+    between the extents of the pages and of the page map itself.
+    Until pager_close writes a new page map and header, the file on disk is the one described by
+    the old ones: if the process dies, it is what the next open finds. So nothing they reference
+    is overwritten in the meantime: the old page map keeps its extent, and a page whose extent
+    it references moves to a new one when it is written back (pager_flush_compressed). The space
+    they leave is only reused once the file has been closed, as a gap found by the next load.
+*/
+static void page_map_load(Pager *pager, const uint8_t *header)
+{
+    uint32_t num_pages, page_map_offset;
+    memcpy(&num_pages, header + COMPRESSED_FILE_NUM_PAGES_OFFSET, sizeof(uint32_t));
+    memcpy(&page_map_offset, header + COMPRESSED_FILE_PAGE_MAP_OFFSET, sizeof(uint32_t));
+    pager->num_pages = num_pages;
+    page_map_grow(pager, num_pages);
+    pager_read_at(pager, page_map_offset, pager->page_map, num_pages * sizeof(PageExtent));
+
+    PageExtent *extents = malloc((num_pages + 1) * sizeof(PageExtent));
+    uint32_t num_extents = 0;
+    for (uint32_t i = 0; i < num_pages; i++)
+    {
+        pager->committed_extents[i] = pager->page_map[i].length > 0;
+        if (pager->page_map[i].length > 0)
+            extents[num_extents++] = pager->page_map[i];
+    }
+    PageExtent page_map_extent = {page_map_offset, num_pages * sizeof(PageExtent), num_pages * sizeof(PageExtent)};
+    extents[num_extents++] = page_map_extent;
+    qsort(extents, num_extents, sizeof(PageExtent), compare_extent_offsets);
+
+    uint32_t end = COMPRESSED_FILE_SECTOR_SIZE;
+    for (uint32_t i = 0; i < num_extents; i++)
+    {
+        if (extents[i].offset > end)
+            free_extents_add(pager, end, extents[i].offset - end);
+        end = extents[i].offset + extents[i].capacity;
+    }
+    pager->file_length = end;
+    free(extents);
+}
+
+// Opens the database file and keeps track of its size. It also initializes an empty buffer pool.
+// A new file is created compressed when asked to, an existing one keeps its format.
+Pager *pager_open(const char *filename, bool compressed)
+{
+    bool in_memory = strcmp(filename, PAGER_IN_MEMORY) == 0;
+    Vfs *vfs = NULL;
+    VfsFile *file = NULL;
+    int64_t file_length = 0;
+    if (!in_memory)
+    {
+        vfs = vfs_default();
+        file = vfs->open(vfs, filename);
+        if (file == NULL)
+        {
+            printf("Unable to open file\n");
+            exit(EXIT_FAILURE);
+        }
+        // a second process writing back its own pages would corrupt the file
+        if (file->methods->lock(file) == -1)
+        {
+            printf("Database is locked by another process.\n");
+            exit(EXIT_FAILURE);
+        }
+        file_length = file->methods->size(file);
+    }
+
+    Pager *pager = malloc(sizeof(Pager));
+    pager->in_memory = in_memory;
+    pager->warm_filename = NULL;
+    if (!in_memory)
+    {
+        pager->warm_filename = malloc(strlen(filename) + sizeof(WARM_FILE_SUFFIX));
+        strcpy(pager->warm_filename, filename);
+        strcat(pager->warm_filename, WARM_FILE_SUFFIX);
+    }
+    pager->vfs = vfs;
+    pager->file = file;
+    pager->file_length = file_length;
+    pager->num_pages = (file_length / PAGE_SIZE);
+
+    pager->page_map = NULL;
+    pager->committed_extents = NULL;
+    pager->page_map_capacity = 0;
+    pager->free_extents = NULL;
+    pager->num_free_extents = 0;
+    pager->free_extents_capacity = 0;
+    pager->compression_buffer = malloc(PAGE_SIZE);
+    memset(&(pager->stats), 0, sizeof(PagerStats));
+
+    uint8_t header[COMPRESSED_FILE_SECTOR_SIZE];
+    memset(header, 0, COMPRESSED_FILE_SECTOR_SIZE);
+    if (file_length >= COMPRESSED_FILE_SECTOR_SIZE)
+        pager_read_at(pager, 0, header, COMPRESSED_FILE_SECTOR_SIZE);
+    pager->compressed = file_length == 0 ? compressed && !in_memory
+                                         : strncmp((char *)header, COMPRESSED_FILE_MAGIC, COMPRESSED_FILE_MAGIC_SIZE) == 0;
+
+    if (pager->compressed && file_length == 0)
+    {
+        pager->num_pages = 0;
+        pager->file_length = COMPRESSED_FILE_SECTOR_SIZE;
+    }
+    else if (pager->compressed)
+        page_map_load(pager, header);
+    else if (file_length % PAGE_SIZE != 0)
+    {
+        printf("Db file is not a whole number of pages. Corrupt file.\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // cache
+    pager->capacity = in_memory ? UINT32_MAX : TABLE_MAX_PAGES;
+    pager->num_frames = 0;
+    pager->num_buckets = 128;
+    pager->page_table = calloc(pager->num_buckets, sizeof(Frame *));
+    memset(&(pager->lru), 0, sizeof(FrameList));
+    memset(&(pager->ring), 0, sizeof(FrameList));
+    pager->scans = 0;
+
+    return pager;
+}
+
+// Loads a page of a compressed file, returns false if it was never written
+static bool pager_read_compressed(Pager *pager, uint32_t page_num, void *page)
+{
+    PageExtent *extent = &(pager->page_map[page_num]);
+    if (extent->length == 0)
+        return false;
+    if (extent->length == PAGE_SIZE)
+    {
+        pager_read_at(pager, extent->offset, page, PAGE_SIZE);
+        return true;
+    }
+    pager_read_at(pager, extent->offset, pager->compression_buffer, extent->length);
+    if (!lz_decompress(pager->compression_buffer, extent->length, page, PAGE_SIZE))
+    {
+        printf("Page %d is corrupt.\n", page_num);
+        exit(EXIT_FAILURE);
+    }
+    return true;
+}
+
+static uint32_t *page_checksum(void *page)
+{
+    return page + PAGE_USABLE_SIZE;
+}
+
+/*
+    A page read from the file must have the checksum written by pager_flush, so that a torn or
+    corrupt page stops the database before a split copies its content elsewhere.
+    That includes a page of zeros: every page within the file was written by pager_flush.
+    The pages that were never written are not read at all, get_frame starts them from zeros:
+    those past the end of a plain file, and those without an extent in a compressed one.
+*/
+static bool page_is_valid(void *page)
+{
+    return *page_checksum(page) == crc32c(page, PAGE_USABLE_SIZE);
+}
+
+static void page_verify(void *page, uint32_t page_num)
+{
+    if (!page_is_valid(page))
+    {
+        printf("Page %d is corrupt: bad checksum.\n", page_num);
+        exit(EXIT_FAILURE);
+    }
+}
+
+// The page is allocated with its frame, right after it, so that the frame of a page is found
+// without a lookup (page_frame)
+static Frame *frame_new(uint32_t page_num)
+{
+    Frame *frame = malloc(sizeof(Frame) + PAGE_SIZE);
+    frame->page_num = page_num;
+    frame->page = frame + 1;
+    frame->dirty = false;
+    frame->children = NULL;
+    frame->num_children = 0;
+    frame->swizzled_parent = NULL;
+    return frame;
+}
+
+static Frame *page_frame(void *page)
+{
+    return (Frame *)page - 1;
+}
+
+// adds a loaded frame to the page table and to the front of its list
+static void frame_install(Pager *pager, Frame *frame)
+{
+    if (pager->num_frames >= pager->num_buckets)
+        page_table_grow(pager);
+    Frame **bucket = page_table_bucket(pager, frame->page_num);
+    frame->hash_next = *bucket;
+    *bucket = frame;
+    // a page read by a scan goes to the ring, it joins the LRU list if something else uses it
+    frame->in_ring = pager->scans > 0 && !pager->in_memory;
+    list_push_front(frame_list(pager, frame), frame);
+    pager->num_frames++;
+}
+
+// Cache hit, the page becomes the most recently used, unless it is only seen by a scan
+static void frame_hit(Pager *pager, Frame *frame)
+{
+    pager->stats.hits++;
+    if (pager->scans == 0)
+        lru_promote(pager, frame);
+}
+
+static Frame *get_frame(Pager *pager, uint32_t page_num)
+{
+    Frame *frame = page_table_find(pager, page_num);
+    if (frame != NULL)
+    {
+        frame_hit(pager, frame);
+        return frame;
+    }
+
+    // Cache miss. Allocate memory and load from file.
+    pager->stats.misses++;
+    TRACE_BEGIN(TRACE_PAGE_READ, page_num);
+    frame = frame_new(page_num);
+
+    if (page_num >= pager->num_pages)
+    {
+        pager->num_pages = page_num + 1;
+        if (pager->compressed)
+            page_map_grow(pager, pager->num_pages);
+    }
+
+    uint32_t file_num_pages = pager->file_length / PAGE_SIZE;
+
+    if (pager->compressed)
+    {
+        if (pager_read_compressed(pager, page_num, frame->page))
+            page_verify(frame->page, page_num);
+        else
+        {
+            memset(frame->page, 0, PAGE_SIZE);
+            frame->dirty = true;
+        }
+    }
+    // We have the data for the given page in the file, so we load the cache page with it
+    else if (page_num < file_num_pages)
+    {
+        pager_read_at(pager, page_num * PAGE_SIZE, frame->page, PAGE_SIZE);
+        page_verify(frame->page, page_num);
+    }
+    else
+    {
+        // a brand new page, it only exists in memory until written back
+        memset(frame->page, 0, PAGE_SIZE);
+        frame->dirty = true;
+    }
+    TRACE_END(TRACE_PAGE_READ, page_num);
+
+    frame_install(pager, frame);
+    return frame;
+}
+
+// Attempts to get the page from the buffer pool.
+// if miss, allocates memory for this page and loads it from the file.
+void *get_page(Pager *pager, uint32_t page_num)
+{
+    return get_frame(pager, page_num)->page;
+}
+
+/*
+    Pointer swizzling: the frame of an internal node keeps pointers to the frames of its resident
+    children, by child index, so that a descent doesn't go through the page table at every level.
+    The page itself keeps the page numbers, it is written back as is. A reference is only a hint
+    checked against the page number of the child: cells move when the node is split or gets a new
+    child, and the reference of a moved cell simply misses once.
+    A frame is referenced by at most one parent, which it remembers: evicting it clears that
+    reference, and evicting the parent forgets all its references.
+*/
+static void swizzle(Frame *parent, uint32_t child_index, Frame *child)
+{
+    if (child_index >= parent->num_children)
+    {
+        uint32_t num_children = child_index + 1 > 2 * parent->num_children ? child_index + 1 : 2 * parent->num_children;
+        parent->children = realloc(parent->children, num_children * sizeof(Frame *));
+        memset(parent->children + parent->num_children, 0, (num_children - parent->num_children) * sizeof(Frame *));
+        parent->num_children = num_children;
+    }
+    if (parent->children[child_index] != NULL)
+        parent->children[child_index]->swizzled_parent = NULL;
+    if (child->swizzled_parent != NULL)
+        child->swizzled_parent->children[child->swizzled_index] = NULL;
+    parent->children[child_index] = child;
+    child->swizzled_parent = parent;
+    child->swizzled_index = child_index;
+}
+
+static void unswizzle(Frame *frame)
+{
+    if (frame->swizzled_parent != NULL)
+        frame->swizzled_parent->children[frame->swizzled_index] = NULL;
+    for (uint32_t i = 0; i < frame->num_children; i++)
+        if (frame->children[i] != NULL)
+            frame->children[i]->swizzled_parent = NULL;
+    free(frame->children);
+}
+
+// get_page for a child of an internal node (a page returned by get_page), through the swizzled
+// reference of the parent when it has one
+void *get_child_page(Pager *pager, void *parent_page, uint32_t child_index, uint32_t child_page_num)
+{
+    Frame *parent = page_frame(parent_page);
+    if (child_index < parent->num_children)
+    {
+        Frame *child = parent->children[child_index];
+        if (child != NULL && child->page_num == child_page_num)
+        {
+            frame_hit(pager, child);
+            return child->page;
+        }
+    }
+    Frame *child = get_frame(pager, child_page_num);
+    swizzle(parent, child_index, child);
+    return child->page;
+}
+
+// Same as get_page, for a page that the caller is going to modify
+void *get_page_for_write(Pager *pager, uint32_t page_num)
+{
+    Frame *frame = get_frame(pager, page_num);
+    // modified pages are kept, a scan that writes (like building an index) reuses them
+    if (frame->in_ring)
+        lru_promote(pager, frame);
+    frame->dirty = true;
+    return frame->page;
+}
+
+/*
+    Warm-up list: pager_close writes the page numbers of the LRU list, hottest first, in a file
+    next to the database (WARM_FILE_SUFFIX): their count, the page numbers, and the CRC32C of both.
+    pager_warm_up reads them back when the database is opened, so the pool starts as hot as it was
+    instead of filling up one miss at a time. The pages are read in file order, a run of consecutive
+    pages at a time, and every run is announced to the VFS first so that the OS reads ahead.
+    The list is only a hint: a missing or damaged one is ignored, and so are the pages past the end
+    of the file or with a bad checksum (get_page reports those). Compressed pages are scattered and
+    have to be decompressed one by one, compressed files are not warmed up.
+*/
+// pages read at once during the warm-up
+#define WARM_UP_RUN_MAX 32
+
+static void warm_list_save(Pager *pager)
+{
+    uint32_t count = pager->lru.length < pager->capacity ? pager->lru.length : pager->capacity;
+    uint32_t size = (count + 2) * sizeof(uint32_t);
+    uint32_t *list = malloc(size);
+    list[0] = count;
+    Frame *frame = pager->lru.head;
+    for (uint32_t i = 1; i <= count; i++, frame = frame->lru_next)
+        list[i] = frame->page_num;
+    list[count + 1] = crc32c(list, size - sizeof(uint32_t));
+
+    VfsFile *file = pager->vfs->open(pager->vfs, pager->warm_filename);
+    if (file != NULL)
+    {
+        if (file->methods->write_at(file, 0, list, size) == size)
+            file->methods->truncate(file, size);
+        file->methods->close(file);
+    }
+    free(list);
+}
+
+// NULL if there is no valid list, the count goes in num_pages
+static uint32_t *warm_list_load(Pager *pager, uint32_t *num_pages)
+{
+    VfsFile *file = pager->vfs->open(pager->vfs, pager->warm_filename);
+    if (file == NULL)
+        return NULL;
+    int64_t size = file->methods->size(file);
+    uint32_t *list = NULL;
+    if (size >= 2 * sizeof(uint32_t) && size % sizeof(uint32_t) == 0 &&
+        size <= (pager->capacity + 2) * sizeof(uint32_t))
+    {
+        list = malloc(size);
+        if (file->methods->read_at(file, 0, list, size) != size || list[0] != size / sizeof(uint32_t) - 2 ||
+            list[list[0] + 1] != crc32c(list, size - sizeof(uint32_t)))
+        {
+            free(list);
+            list = NULL;
+        }
+    }
+    file->methods->close(file);
+    if (list == NULL)
+        return NULL;
+    *num_pages = list[0];
+    memmove(list, list + 1, list[0] * sizeof(uint32_t));
+    return list;
+}
+
+static int compare_page_nums(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Loads the pages of the warm-up list written when the file was last closed, see above
+void pager_warm_up(Pager *pager)
+{
+    uint32_t num_pages;
+    if (pager->in_memory || pager->compressed || pager->num_pages == 0)
+        return;
+    uint32_t *hottest_first = warm_list_load(pager, &num_pages);
+    if (hottest_first == NULL)
+        return;
+
+    uint32_t file_num_pages = pager->file_length / PAGE_SIZE;
+    uint32_t *sorted = malloc(num_pages * sizeof(uint32_t));
+    uint32_t num_sorted = 0;
+    memcpy(sorted, hottest_first, num_pages * sizeof(uint32_t));
+    qsort(sorted, num_pages, sizeof(uint32_t), compare_page_nums);
+    for (uint32_t i = 0; i < num_pages; i++)
+        if (sorted[i] < file_num_pages && (num_sorted == 0 || sorted[i] != sorted[num_sorted - 1]) &&
+            page_table_find(pager, sorted[i]) == NULL)
+            sorted[num_sorted++] = sorted[i];
+
+    // runs of consecutive pages: all of them are announced, then read one after the other
+    for (uint32_t pass = 0; pass < 2; pass++)
+    {
+        uint8_t *buffer = pass == 0 ? NULL : malloc(WARM_UP_RUN_MAX * PAGE_SIZE);
+        uint32_t start = 0;
+        while (start < num_sorted)
+        {
+            uint32_t length = 1;
+            while (start + length < num_sorted && length < WARM_UP_RUN_MAX &&
+                   sorted[start + length] == sorted[start] + length)
+                length++;
+            if (pass == 0)
+                pager->file->methods->prefetch(pager->file, (uint64_t)sorted[start] * PAGE_SIZE, length * PAGE_SIZE);
+            else
+            {
+                pager_read_at(pager, sorted[start] * PAGE_SIZE, buffer, length * PAGE_SIZE);
+                for (uint32_t i = 0; i < length; i++)
+                {
+                    void *page = buffer + i * PAGE_SIZE;
+                    if (!page_is_valid(page))
+                        continue;
+                    Frame *frame = frame_new(sorted[start + i]);
+                    memcpy(frame->page, page, PAGE_SIZE);
+                    frame_install(pager, frame);
+                    pager->stats.warmed_up++;
+                }
+            }
+            start += length;
+        }
+        free(buffer);
+    }
+
+    // back in the order of the list, the hottest page at the front
+    for (uint32_t i = num_pages; i > 0; i--)
+    {
+        Frame *frame = page_table_find(pager, hottest_first[i - 1]);
+        if (frame != NULL)
+            lru_promote(pager, frame);
+    }
+    free(sorted);
+    free(hottest_first);
+}
+
+/*
+    Until we start recycling free pages, new pages will always
+    go onto the end of the database file.
+*/
+uint32_t get_unused_page_num(Pager *pager) { return pager->num_pages; }
+
+/*
+    Compresses the page and writes it in its extent, the page moves to a bigger one when it doesn't fit
+    anymore. A page that doesn't compress is stored as is.
+*/
+static void pager_flush_compressed(Pager *pager, Frame *frame)
+{
+    PageExtent *extent = &(pager->page_map[frame->page_num]);
+    const void *data = pager->compression_buffer;
+    uint32_t length = lz_compress(frame->page, PAGE_SIZE, pager->compression_buffer, PAGE_SIZE - 1);
+    if (length == 0)
+    {
+        data = frame->page;
+        length = PAGE_SIZE;
+    }
+
+    // the extent read by the page map on disk stays as it is until a new map replaces it
+    if (pager->committed_extents[frame->page_num])
+    {
+        pager->committed_extents[frame->page_num] = false;
+        extent->capacity = 0;
+    }
+    if (length > extent->capacity)
+    {
+        if (extent->capacity > 0)
+            free_extents_add(pager, extent->offset, extent->capacity);
+        extent->capacity = (length + COMPRESSED_FILE_SECTOR_SIZE - 1) / COMPRESSED_FILE_SECTOR_SIZE * COMPRESSED_FILE_SECTOR_SIZE;
+        extent->offset = pager_allocate_extent(pager, extent->capacity);
+    }
+    extent->length = length;
+    pager_write_at(pager, extent->offset, data, length);
+    frame->dirty = false;
+}
+
+// Asks the OS to start reading a page that will be needed soon, unless it is in the pool already
+void pager_prefetch(Pager *pager, uint32_t page_num)
+{
+    if (pager->compressed || page_num >= pager->file_length / PAGE_SIZE || page_table_find(pager, page_num) != NULL)
+        return;
+    pager->file->methods->prefetch(pager->file, (uint64_t)page_num * PAGE_SIZE, PAGE_SIZE);
+}
+
+void pager_flush(Pager *pager, uint32_t page_num)
+{
+    Frame *frame = page_table_find(pager, page_num);
+    if (frame == NULL)
+    {
+        printf("Tried to flush null page\n");
+        exit(EXIT_FAILURE);
+    }
+
+    TRACE_BEGIN(TRACE_PAGE_FLUSH, page_num);
+    *page_checksum(frame->page) = crc32c(frame->page, PAGE_USABLE_SIZE);
+    if (pager->compressed)
+        pager_flush_compressed(pager, frame);
+    else
+    {
+        pager_write_at(pager, page_num * PAGE_SIZE, frame->page, PAGE_SIZE);
+        frame->dirty = false;
+        if ((page_num + 1) * PAGE_SIZE > pager->file_length)
+            pager->file_length = (page_num + 1) * PAGE_SIZE;
+    }
+    TRACE_END(TRACE_PAGE_FLUSH, page_num);
+}
+
+static void pager_evict(Pager *pager, Frame *frame)
+{
+    if (frame->dirty && !pager->in_memory)
+        pager_flush(pager, frame->page_num);
+    pager->stats.evictions++;
+    page_table_remove(pager, frame);
+    list_unlink(frame_list(pager, frame), frame);
+    pager->num_frames--;
+    unswizzle(frame);
+    free(frame);
+}
+
+// A scan reads its pages through the ring until the matching pager_end_scan, scans can nest
+void pager_begin_scan(Pager *pager)
+{
+    pager->scans++;
+}
+
+void pager_end_scan(Pager *pager)
+{
+    pager->scans--;
+}
+
+// Writes back and drops the least recently used pages until the pool is back to its capacity.
+// Invalidates every page pointer obtained before.
+void pager_trim(Pager *pager)
+{
+    while (pager->ring.length > SCAN_RING_SIZE)
+        pager_evict(pager, pager->ring.tail);
+    while (pager->lru.length > pager->capacity)
+        pager_evict(pager, pager->lru.tail);
+}
+
+// flushes the modified pages, closes the database file and frees the buffer pool
+void pager_close(Pager *pager)
+{
+    if (!pager->in_memory && !pager->compressed)
+        warm_list_save(pager);
+    while (pager->ring.head != NULL)
+        pager_evict(pager, pager->ring.head);
+    while (pager->lru.head != NULL)
+        pager_evict(pager, pager->lru.head);
+
+    // the page map goes after the pages, the header says where
+    if (pager->compressed)
+    {
+        uint8_t header[COMPRESSED_FILE_SECTOR_SIZE];
+        uint32_t page_map_size = pager->num_pages * sizeof(PageExtent);
+        memset(header, 0, COMPRESSED_FILE_SECTOR_SIZE);
+        strncpy((char *)header, COMPRESSED_FILE_MAGIC, COMPRESSED_FILE_MAGIC_SIZE);
+        memcpy(header + COMPRESSED_FILE_NUM_PAGES_OFFSET, &(pager->num_pages), sizeof(uint32_t));
+        memcpy(header + COMPRESSED_FILE_PAGE_MAP_OFFSET, &(pager->file_length), sizeof(uint32_t));
+        // the pages and the new map are on disk before the header switches to them
+        pager_write_at(pager, pager->file_length, pager->page_map, page_map_size);
+        pager->stats.syncs++;
+        if (pager->file->methods->sync(pager->file) == -1)
+        {
+            printf("Error syncing db file: %d\n", errno);
+            exit(EXIT_FAILURE);
+        }
+        pager_write_at(pager, 0, header, COMPRESSED_FILE_SECTOR_SIZE);
+        if (pager->file->methods->truncate(pager->file, pager->file_length + page_map_size) == -1)
+        {
+            printf("Error truncating db file: %d\n", errno);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    if (!pager->in_memory)
+    {
+        pager->stats.syncs++;
+        if (pager->file->methods->sync(pager->file) == -1 || pager->file->methods->close(pager->file) == -1)
+        {
+            printf("Error closing db file.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    free(pager->page_table);
+    free(pager->page_map);
+    free(pager->committed_extents);
+    free(pager->free_extents);
+    free(pager->compression_buffer);
+    free(pager->warm_filename);
+    free(pager);
+}
+
+// .stats: what the buffer pool did since the file was opened, and what it holds now
+void pager_print_stats(Pager *pager)
+{
+    PagerStats *stats = &(pager->stats);
+    uint64_t accesses = stats->hits + stats->misses;
+    uint32_t num_dirty = 0;
+    for (Frame *frame = pager->lru.head; frame != NULL; frame = frame->lru_next)
+        num_dirty += frame->dirty;
+    for (Frame *frame = pager->ring.head; frame != NULL; frame = frame->lru_next)
+        num_dirty += frame->dirty;
+
+    printf("Buffer pool:\n");
+    printf("  hits: %lu (%.1f%%)\n", (unsigned long)stats->hits, accesses == 0 ? 0 : 100.0 * stats->hits / accesses);
+    printf("  misses: %lu\n", (unsigned long)stats->misses);
+    printf("  evictions: %lu\n", (unsigned long)stats->evictions);
+    printf("  warmed up: %lu\n", (unsigned long)stats->warmed_up);
+    if (pager->in_memory)
+        printf("  pages: %d in memory, no capacity\n", pager->num_frames);
+    else
+        printf("  pages: %d in memory (%d in the scan ring), %d dirty, capacity %d\n", pager->num_frames,
+               pager->ring.length, num_dirty, pager->capacity);
+    if (pager->in_memory)
+    {
+        printf("File: none, the database is in memory.\n");
+        return;
+    }
+    printf("File (%s):\n", pager->vfs->name);
+    printf("  bytes read: %lu in %lu reads\n", (unsigned long)stats->bytes_read, (unsigned long)stats->reads);
+    printf("  bytes written: %lu in %lu writes\n", (unsigned long)stats->bytes_written, (unsigned long)stats->writes);
+    printf("  syncs: %lu\n", (unsigned long)stats->syncs);
+}
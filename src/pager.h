@@ -0,0 +1,136 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "vfs.h"
+
+#ifndef PAGER_HEADER
+#define PAGER_HEADER
+
+// Number of pages the buffer pool keeps in memory between statements.
+// The file itself can grow past it: least recently used pages are written back and dropped.
+#define TABLE_MAX_PAGES 100
+// Pages read by a scan stay in a ring of their own instead of pushing the hot pages out
+#define SCAN_RING_SIZE 16
+// Database name of a scratch database that only lives in the buffer pool
+#define PAGER_IN_MEMORY ":memory:"
+extern const uint32_t PAGE_SIZE;
+extern const uint32_t PAGE_CHECKSUM_SIZE;
+extern const uint32_t PAGE_USABLE_SIZE;
+extern const char WARM_FILE_SUFFIX[];
+
+// A page loaded in memory. Frames are linked in two lists:
+// the bucket of the page table they belong to and either the LRU list or the scan ring.
+typedef struct Frame
+{
+  uint32_t page_num;
+  bool dirty;   /* modified since it was read, has to be written back */
+  bool in_ring; /* only read by a scan so far */
+  void *page;
+  struct Frame *hash_next;
+  struct Frame *lru_prev; /* more recently used */
+  struct Frame *lru_next; /* less recently used */
+  // swizzled references (see get_child_page)
+  struct Frame **children; /* of an internal node: resident children by child index, or NULL */
+  uint32_t num_children;
+  struct Frame *swizzled_parent; /* frame holding a reference to this one, NULL if none */
+  uint32_t swizzled_index;
+} Frame;
+
+typedef struct
+{
+  Frame *head; /* most recently used */
+  Frame *tail;
+  uint32_t length;
+} FrameList;
+
+// Where a page of a compressed file is stored
+typedef struct
+{
+  uint32_t offset;   /* in bytes from the start of the file */
+  uint32_t length;   /* size of the compressed page, PAGE_SIZE when stored as is, 0 if never written */
+  uint32_t capacity; /* bytes reserved for it, a whole number of sectors */
+} PageExtent;
+
+// Counters of the buffer pool and of the file, since it was opened (see .stats).
+// The engine is single threaded: they are plain fields bumped where the events happen.
+typedef struct
+{
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t evictions;
+  uint64_t warmed_up; /* pages loaded by pager_warm_up */
+  uint64_t bytes_read;
+  uint64_t bytes_written;
+  uint64_t reads;  /* calls to read_at of the VFS */
+  uint64_t writes; /* calls to write_at of the VFS */
+  uint64_t syncs;
+} PagerStats;
+
+// Structure used by a database to access its file (through the VFS).
+// Or to load the data from memory (pager), all the btrees of the file share it.
+typedef struct
+{
+  bool in_memory; /* no file: every page stays in the pool and is never written back */
+  char *warm_filename; /* where pager_close saves the hot pages, NULL in memory */
+  Vfs *vfs;       /* NULL in memory */
+  VfsFile *file;
+  uint32_t file_length;
+  uint32_t num_pages;
+  // buffer pool
+  uint32_t capacity;   /* frames of the LRU list kept by pager_trim */
+  uint32_t num_frames;
+  uint32_t num_buckets; /* power of 2 */
+  Frame **page_table;   /* page number -> frame, chained buckets */
+  FrameList lru;
+  FrameList ring; /* FIFO of the pages read by scans, SCAN_RING_SIZE kept by pager_trim */
+  uint32_t scans; /* scans in progress */
+  // compressed files: pages are compressed on write back and stored wherever they fit
+  bool compressed;
+  PageExtent *page_map; /* page number -> extent, num_pages entries */
+  bool *committed_extents; /* page number -> its extent is the one of the page map on disk */
+  uint32_t page_map_capacity;
+  PageExtent *free_extents; /* space left by pages that had to move */
+  uint32_t num_free_extents;
+  uint32_t free_extents_capacity;
+  void *compression_buffer;
+  PagerStats stats;
+} Pager;
+
+/*
+  The file is opened with the default VFS (see vfs.h) and locked for the process.
+  pager_close saves the list of the hottest pages next to the file, pager_warm_up loads them back.
+  PAGER_IN_MEMORY opens no file at all: the pool has no capacity, so pages are never evicted
+  nor flushed, and they are dropped by pager_close.
+  A database file is created compressed or not, the format of an existing file is detected.
+  A compressed file starts with a header sector, then every page is stored compressed in a run of sectors
+  that moves to a bigger one when the page grows. The page map giving those extents is kept in memory and
+  written after the pages when the file is closed. Until then, nothing the previous map references is
+  overwritten, so a process that dies leaves the file as it was last closed.
+  Page pointers returned by get_page stay valid until the next call to pager_trim.
+  A descent goes from a node to its child with get_child_page, which follows a pointer kept in
+  the frame of the parent once the child is resident (pointer swizzling).
+  The btree code keeps raw pointers on several pages while it splits nodes, so pages are
+  only evicted at points where nobody holds one: between statements and when a cursor
+  moves to its next cell.
+  Pages that are going to be modified are fetched with get_page_for_write so they are
+  written back before being evicted.
+  Between pager_begin_scan and pager_end_scan, the pages missed go to the scan ring and the
+  pages hit stay where they are: a full scan of a big table cycles through the ring and
+  leaves the LRU list, the pages of the point lookups, as it was. A page of the ring that is
+  used again outside of a scan, or modified, moves to the LRU list.
+*/
+Pager *pager_open(const char *filename, bool compressed);
+void *get_page(Pager *pager, uint32_t page_num);
+void *get_page_for_write(Pager *pager, uint32_t page_num);
+void *get_child_page(Pager *pager, void *parent_page, uint32_t child_index, uint32_t child_page_num);
+uint32_t get_unused_page_num(Pager *pager);
+void pager_prefetch(Pager *pager, uint32_t page_num);
+void pager_warm_up(Pager *pager);
+void pager_flush(Pager *pager, uint32_t page_num);
+void pager_begin_scan(Pager *pager);
+void pager_end_scan(Pager *pager);
+void pager_trim(Pager *pager);
+void pager_close(Pager *pager);
+void pager_print_stats(Pager *pager);
+
+#endif
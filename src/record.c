@@ -0,0 +1,280 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include "record.h"
+
+const uint32_t RECORD_OFFSET_SIZE = sizeof(uint16_t);
+
+ColumnDefinition column_definition(const char *name, ColumnType type, uint32_t size)
+{
+    ColumnDefinition column;
+    memset(&column, 0, sizeof(ColumnDefinition));
+    strncpy(column.name, name, COLUMN_NAME_SIZE);
+    column.type = type;
+    column.size = size;
+    return column;
+}
+
+bool column_type_is_variable(ColumnType type)
+{
+    return type == COLUMN_TYPE_TEXT || type == COLUMN_TYPE_BLOB;
+}
+
+// bytes taken by a value of a fixed width type
+uint32_t column_type_width(ColumnType type)
+{
+    switch (type)
+    {
+    case (COLUMN_TYPE_INT32):
+        return sizeof(int32_t);
+    case (COLUMN_TYPE_INT64):
+        return sizeof(int64_t);
+    case (COLUMN_TYPE_DOUBLE):
+        return sizeof(double);
+    default:
+        return 0;
+    }
+}
+
+// column number of the given name, -1 if the schema has no such column
+int32_t schema_find_column(Schema *schema, const char *name)
+{
+    for (uint32_t i = 0; i < schema->num_columns; i++)
+    {
+        if (strcmp(schema->columns[i].name, name) == 0)
+            return i;
+    }
+    return -1;
+}
+
+bool schema_is_key_column(Schema *schema, uint32_t column)
+{
+    for (uint32_t i = 0; i < schema->num_key_columns; i++)
+    {
+        if (schema->key_columns[i] == column)
+            return true;
+    }
+    return false;
+}
+
+// numbers as with printf, text as is and blobs in hexadecimal
+void print_value(ColumnType type, void *value, uint32_t length)
+{
+    int32_t int32;
+    int64_t int64;
+    double real;
+    switch (type)
+    {
+    case (COLUMN_TYPE_INT32):
+        memcpy(&int32, value, sizeof(int32_t));
+        printf("%d", int32);
+        break;
+    case (COLUMN_TYPE_INT64):
+        memcpy(&int64, value, sizeof(int64_t));
+        printf("%lld", (long long)int64);
+        break;
+    case (COLUMN_TYPE_DOUBLE):
+        memcpy(&real, value, sizeof(double));
+        printf("%g", real);
+        break;
+    case (COLUMN_TYPE_TEXT):
+        printf("%.*s", length, (char *)value);
+        break;
+    case (COLUMN_TYPE_BLOB):
+        for (uint32_t i = 0; i < length; i++)
+            printf("%02x", ((uint8_t *)value)[i]);
+        break;
+    }
+}
+
+RecordLayout record_layout_compile(Schema *schema)
+{
+    RecordLayout layout;
+    memset(&layout, 0, sizeof(RecordLayout));
+    layout.num_columns = schema->num_columns;
+
+    uint32_t fixed_size = 0;
+    uint32_t variable_size = 0;
+    for (uint32_t i = 0; i < schema->num_columns; i++)
+    {
+        ColumnDescriptor *descriptor = &(layout.columns[i]);
+        descriptor->type = schema->columns[i].type;
+        descriptor->size = schema->columns[i].size;
+        if (column_type_is_variable(descriptor->type))
+        {
+            descriptor->offset = layout.num_variable_columns++;
+            variable_size += descriptor->size;
+        }
+        else
+        {
+            descriptor->offset = fixed_size;
+            fixed_size += descriptor->size;
+        }
+    }
+
+    layout.offset_table_offset = fixed_size;
+    layout.data_offset = fixed_size + layout.num_variable_columns * RECORD_OFFSET_SIZE;
+    layout.max_size = layout.data_offset + variable_size;
+
+    layout.num_key_columns = schema->num_key_columns;
+    for (uint32_t i = 0; i < schema->num_key_columns; i++)
+    {
+        ColumnDefinition *column = &(schema->columns[schema->key_columns[i]]);
+        layout.key_columns[i] = schema->key_columns[i];
+        layout.key_size += key_column_size(column->type, column->size);
+    }
+    return layout;
+}
+
+// Pointer to the bytes of a column in the record, their number is stored in length.
+// A variable width column starts where the previous one ends.
+void *record_column(RecordLayout *layout, void *record, uint32_t column, uint32_t *length)
+{
+    ColumnDescriptor *descriptor = &(layout->columns[column]);
+    if (!column_type_is_variable(descriptor->type))
+    {
+        *length = descriptor->size;
+        return record + descriptor->offset;
+    }
+
+    uint16_t *ends = record + layout->offset_table_offset;
+    uint32_t start = descriptor->offset == 0 ? layout->data_offset : ends[descriptor->offset - 1];
+    *length = ends[descriptor->offset] - start;
+    return record + start;
+}
+
+// Writes the values of every column (lengths are only read for variable width columns)
+// and returns the size of the record.
+uint32_t record_pack(RecordLayout *layout, void *const *values, const uint32_t *lengths, void *destination)
+{
+    uint16_t *ends = destination + layout->offset_table_offset;
+    uint32_t end = layout->data_offset;
+    for (uint32_t i = 0; i < layout->num_columns; i++)
+    {
+        ColumnDescriptor *descriptor = &(layout->columns[i]);
+        if (!column_type_is_variable(descriptor->type))
+        {
+            memcpy(destination + descriptor->offset, values[i], descriptor->size);
+            continue;
+        }
+        memcpy(destination + end, values[i], lengths[i]);
+        end += lengths[i];
+        ends[descriptor->offset] = end;
+    }
+    return end;
+}
+
+uint32_t record_size(RecordLayout *layout, void *record)
+{
+    if (layout->num_variable_columns == 0)
+        return layout->data_offset;
+    uint16_t *ends = record + layout->offset_table_offset;
+    return ends[layout->num_variable_columns - 1];
+}
+
+// bytes taken by the encoding of a column in a key
+uint32_t key_column_size(ColumnType type, uint32_t size)
+{
+    // every byte may be escaped, plus the terminator
+    if (column_type_is_variable(type))
+        return 2 * size + 2;
+    return size;
+}
+
+static void write_big_endian(uint64_t value, uint32_t size, uint8_t *destination)
+{
+    for (uint32_t i = 0; i < size; i++)
+        destination[i] = value >> (8 * (size - 1 - i));
+}
+
+static uint64_t read_big_endian(const uint8_t *source, uint32_t size)
+{
+    uint64_t value = 0;
+    for (uint32_t i = 0; i < size; i++)
+        value = value << 8 | source[i];
+    return value;
+}
+
+// Encodes a value (as stored in a record) into its slot of a key, see record.h
+void key_encode_value(ColumnType type, uint32_t size, const void *value, uint32_t length, void *destination)
+{
+    uint8_t *key = destination;
+    const uint8_t *bytes = value;
+    uint32_t int32;
+    uint64_t int64;
+    switch (type)
+    {
+    case (COLUMN_TYPE_INT32):
+        memcpy(&int32, value, sizeof(uint32_t));
+        write_big_endian(int32 ^ 0x80000000u, sizeof(uint32_t), key);
+        break;
+    case (COLUMN_TYPE_INT64):
+        memcpy(&int64, value, sizeof(uint64_t));
+        write_big_endian(int64 ^ 0x8000000000000000ull, sizeof(uint64_t), key);
+        break;
+    case (COLUMN_TYPE_DOUBLE):
+        memcpy(&int64, value, sizeof(uint64_t));
+        int64 = (int64 & 0x8000000000000000ull) ? ~int64 : int64 ^ 0x8000000000000000ull;
+        write_big_endian(int64, sizeof(uint64_t), key);
+        break;
+    case (COLUMN_TYPE_TEXT):
+    case (COLUMN_TYPE_BLOB):
+        memset(key, 0, key_column_size(type, size));
+        for (uint32_t i = 0; i < length; i++)
+        {
+            *key++ = bytes[i];
+            if (bytes[i] == 0)
+                *key++ = 0xFF;
+        }
+        key[0] = 0;
+        key[1] = 1;
+        break;
+    }
+}
+
+// Decodes the slot of a key back into a value as stored in a record, returns its length
+uint32_t key_decode_value(ColumnType type, const void *key, void *destination)
+{
+    const uint8_t *bytes = key;
+    uint8_t *value = destination;
+    uint32_t int32;
+    uint64_t int64;
+    uint32_t length = 0;
+    switch (type)
+    {
+    case (COLUMN_TYPE_INT32):
+        int32 = read_big_endian(bytes, sizeof(uint32_t)) ^ 0x80000000u;
+        memcpy(destination, &int32, sizeof(uint32_t));
+        return sizeof(uint32_t);
+    case (COLUMN_TYPE_INT64):
+        int64 = read_big_endian(bytes, sizeof(uint64_t)) ^ 0x8000000000000000ull;
+        memcpy(destination, &int64, sizeof(uint64_t));
+        return sizeof(uint64_t);
+    case (COLUMN_TYPE_DOUBLE):
+        int64 = read_big_endian(bytes, sizeof(uint64_t));
+        int64 = (int64 & 0x8000000000000000ull) ? int64 ^ 0x8000000000000000ull : ~int64;
+        memcpy(destination, &int64, sizeof(uint64_t));
+        return sizeof(uint64_t);
+    case (COLUMN_TYPE_TEXT):
+    case (COLUMN_TYPE_BLOB):
+        // 0x00 0x01 ends the value, 0x00 0xFF is an escaped 0x00
+        for (; !(bytes[0] == 0 && bytes[1] == 1); bytes += bytes[0] == 0 ? 2 : 1)
+            value[length++] = bytes[0];
+        return length;
+    }
+    return 0;
+}
+
+// encodes the primary key columns of the record
+void record_build_key(RecordLayout *layout, void *record, void *key)
+{
+    uint32_t length;
+    for (uint32_t i = 0; i < layout->num_key_columns; i++)
+    {
+        ColumnDescriptor *descriptor = &(layout->columns[layout->key_columns[i]]);
+        void *value = record_column(layout, record, layout->key_columns[i], &length);
+        key_encode_value(descriptor->type, descriptor->size, value, length, key);
+        key += key_column_size(descriptor->type, descriptor->size);
+    }
+}
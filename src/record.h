@@ -0,0 +1,114 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef RECORD_HEADER
+#define RECORD_HEADER
+
+// Schemas, stored in the catalog with every table.
+#define TABLE_NAME_SIZE 31
+#define COLUMN_NAME_SIZE 31
+#define TABLE_MAX_COLUMNS 16
+// set of columns, one bit per column number
+#define COLUMN_BIT(column) (1u << (column))
+
+// biggest record a table can hold, so that a leaf always has room for a few of them
+#define RECORD_MAX_SIZE 1024
+// biggest encoded primary key, so that internal nodes keep a useful fan out
+#define KEY_MAX_SIZE 256
+// default maximum length of the text and blob columns
+#define COLUMN_DEFAULT_VARIABLE_SIZE 255
+
+typedef enum
+{
+  COLUMN_TYPE_INT32,
+  COLUMN_TYPE_INT64,
+  COLUMN_TYPE_DOUBLE,
+  COLUMN_TYPE_TEXT,
+  COLUMN_TYPE_BLOB
+} ColumnType;
+
+typedef struct
+{
+  char name[COLUMN_NAME_SIZE + 1];
+  ColumnType type;
+  uint32_t size; /* bytes for numbers, maximum length for text and blobs */
+} ColumnDefinition;
+
+// How the leaves of a table store their rows (see leaf_encoding.h and leaf_columns.h)
+typedef enum
+{
+  LEAF_FORMAT_ROWS,    /* fixed size cells (key, record) */
+  LEAF_FORMAT_ENCODED, /* column by column, with a dictionary or frame of reference encoding */
+  LEAF_FORMAT_COLUMNS  /* a minipage per column, the values as they are */
+} LeafFormat;
+
+// The primary key is made of one or more columns, the first one by default.
+typedef struct
+{
+  uint32_t num_columns;
+  ColumnDefinition columns[TABLE_MAX_COLUMNS];
+  uint32_t num_key_columns;
+  uint32_t key_columns[TABLE_MAX_COLUMNS];
+  LeafFormat leaf_format;
+} Schema;
+
+/*
+  Record layout, compiled once from the schema of a table:
+  • fixed width columns (numbers) first, in schema order, at constant offsets
+  • then the offset table: for every variable width column (text, blob), the 16 bits
+    offset where its bytes end in the record
+  • then the bytes of the variable width columns, back to back
+  Text is stored without terminator and nothing is padded, so a record is exactly as
+  long as its data plus 2 bytes per variable width column.
+*/
+typedef struct
+{
+  ColumnType type;
+  uint32_t size;   /* width of a fixed column, maximum length of a variable one */
+  uint32_t offset; /* offset of a fixed column in the record, slot of a variable one in the offset table */
+} ColumnDescriptor;
+
+typedef struct
+{
+  uint32_t num_columns;
+  ColumnDescriptor columns[TABLE_MAX_COLUMNS];
+  uint32_t num_variable_columns;
+  uint32_t offset_table_offset; /* right after the fixed columns */
+  uint32_t data_offset;         /* right after the offset table */
+  uint32_t max_size;
+  // primary key, encoded as described below
+  uint32_t num_key_columns;
+  uint32_t key_columns[TABLE_MAX_COLUMNS];
+  uint32_t key_size;
+} RecordLayout;
+
+/*
+  Keys are encoded so that comparing two of them is a single memcmp, whatever their columns:
+  • integers are big endian with the sign bit flipped, so negative values sort first
+  • doubles have their sign bit flipped when positive and all their bits flipped when negative
+  • text and blobs escape every 0x00 byte as 0x00 0xFF and end with 0x00 0x01, the rest of
+    their slot is zero padded: a value sorts right before the longer values it is a prefix of
+  The columns of a composite key are encoded one after the other, each in a fixed size slot.
+*/
+
+extern const uint32_t RECORD_OFFSET_SIZE;
+
+ColumnDefinition column_definition(const char *name, ColumnType type, uint32_t size);
+bool column_type_is_variable(ColumnType type);
+uint32_t column_type_width(ColumnType type);
+int32_t schema_find_column(Schema *schema, const char *name);
+bool schema_is_key_column(Schema *schema, uint32_t column);
+void print_value(ColumnType type, void *value, uint32_t length);
+
+RecordLayout record_layout_compile(Schema *schema);
+void *record_column(RecordLayout *layout, void *record, uint32_t column, uint32_t *length);
+uint32_t record_pack(RecordLayout *layout, void *const *values, const uint32_t *lengths, void *destination);
+uint32_t record_size(RecordLayout *layout, void *record);
+
+uint32_t key_column_size(ColumnType type, uint32_t size);
+void key_encode_value(ColumnType type, uint32_t size, const void *value, uint32_t length, void *destination);
+uint32_t key_decode_value(ColumnType type, const void *key, void *destination);
+void record_build_key(RecordLayout *layout, void *record, void *key);
+
+#endif
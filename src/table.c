@@ -6,6 +6,11 @@
 #include <unistd.h>
 #include <sys/errno.h>
 #include "table.h"
+#include "index.h"
+#include "hash_index.h"
+#include "leaf_encoding.h"
+#include "leaf_columns.h"
+#include "trace.h"
 
 // 1st version of the database: table as an unsorted list of rows.
 // Select * is easy and fast, as well as insertion when it happens in the end of the table
@@ -18,17 +23,11 @@
 // The node's content or body is stored in a flat way with its metadata because we need
 // to make it persist in the disk file.
 
-// Table, Pager and Row constants
-const uint32_t ID_SIZE = size_of_attribute(Row, id);
-const uint32_t USERNAME_SIZE = size_of_attribute(Row, username);
-const uint32_t EMAIL_SIZE = size_of_attribute(Row, email);
-
-const uint32_t ID_OFFSET = 0;
-const uint32_t USERNAME_OFFSET = ID_OFFSET + ID_SIZE;
-const uint32_t EMAIL_OFFSET = USERNAME_OFFSET + USERNAME_SIZE;
-const uint32_t ROW_SIZE = ID_SIZE + USERNAME_SIZE + EMAIL_SIZE;
-
+// Table and Pager constants
 const uint32_t PAGE_SIZE = 4096; /* same as OS virtual memory page size */
+// the end of every page holds its checksum (see pager.c), the nodes are laid out in the rest
+const uint32_t PAGE_CHECKSUM_SIZE = sizeof(uint32_t);
+const uint32_t PAGE_USABLE_SIZE = PAGE_SIZE - PAGE_CHECKSUM_SIZE;
 
 // Common Node Header Layout
 const uint32_t NODE_TYPE_SIZE = sizeof(uint8_t);
@@ -45,18 +44,26 @@ const uint32_t INTERNAL_NODE_NUM_KEYS_OFFSET = COMMON_NODE_HEADER_SIZE;
 const uint32_t INTERNAL_NODE_RIGHTMOST_CHILD_SIZE = sizeof(uint32_t);
 const uint32_t INTERNAL_NODE_RIGHTMOST_CHILD_OFFSET =
     INTERNAL_NODE_NUM_KEYS_OFFSET + INTERNAL_NODE_NUM_KEYS_SIZE;
-const uint32_t INTERNAL_NODE_HEADER_SIZE =
-    COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE + INTERNAL_NODE_RIGHTMOST_CHILD_SIZE;
+const uint32_t INTERNAL_NODE_PREFIX_LENGTH_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_PREFIX_LENGTH_OFFSET =
+    INTERNAL_NODE_RIGHTMOST_CHILD_OFFSET + INTERNAL_NODE_RIGHTMOST_CHILD_SIZE;
+const uint32_t INTERNAL_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE + INTERNAL_NODE_NUM_KEYS_SIZE +
+                                           INTERNAL_NODE_RIGHTMOST_CHILD_SIZE + INTERNAL_NODE_PREFIX_LENGTH_SIZE;
 
 // Internal Node Body Layout
 /*
-    The body is an array of cells where each cell contains a child pointer and a key.
-    Every key should be the maximum key contained in the child to its left.
+    The body starts with an array of cells where each cell contains a child pointer and
+    the position of its key. The key is a separator: every key of the child is <= to it and
+    every key of the next child is greater. A separator only keeps the bytes needed to tell
+    the two children apart (suffix truncation) and compares as if it was padded with 0xFF.
+    The bytes shared by all the separators of the node are stored once after the cells
+    (prefix truncation), followed by the rest of each separator.
 */
-const uint32_t INTERNAL_NODE_KEY_SIZE = sizeof(uint32_t);
 const uint32_t INTERNAL_NODE_CHILD_SIZE = sizeof(uint32_t);
+const uint32_t INTERNAL_NODE_KEY_OFFSET_SIZE = sizeof(uint16_t);
+const uint32_t INTERNAL_NODE_KEY_LENGTH_SIZE = sizeof(uint16_t);
 const uint32_t INTERNAL_NODE_CELL_SIZE =
-    INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_SIZE;
+    INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_OFFSET_SIZE + INTERNAL_NODE_KEY_LENGTH_SIZE;
 
 // Leaf Node Header Layout
 const uint32_t LEAF_NODE_NUM_CELLS_SIZE = sizeof(uint32_t);
@@ -66,17 +73,83 @@ const uint32_t LEAF_NODE_NEXT_LEAF_OFFSET = LEAF_NODE_NUM_CELLS_OFFSET + LEAF_NO
 const uint32_t LEAF_NODE_HEADER_SIZE = COMMON_NODE_HEADER_SIZE + LEAF_NODE_NUM_CELLS_SIZE + LEAF_NODE_NEXT_LEAF_SIZE;
 
 // Leaf Node Body Layout
-const uint32_t LEAF_NODE_KEY_SIZE = sizeof(uint32_t);
-const uint32_t LEAF_NODE_KEY_OFFSET = 0;
-const uint32_t LEAF_NODE_VALUE_SIZE = ROW_SIZE;
-const uint32_t LEAF_NODE_VALUE_OFFSET = LEAF_NODE_KEY_SIZE + LEAF_NODE_KEY_OFFSET;
-const uint32_t LEAF_NODE_CELL_SIZE = LEAF_NODE_KEY_SIZE + LEAF_NODE_VALUE_SIZE;
-const uint32_t LEAF_NODE_SPACE_FOR_CELLS = PAGE_SIZE - LEAF_NODE_HEADER_SIZE;
-const uint32_t LEAF_NODE_MAX_CELLS = LEAF_NODE_SPACE_FOR_CELLS / LEAF_NODE_CELL_SIZE; /* ~13 with some wasted space in the end of the page/node */
-
-// Used for splitting the leaf node
-const uint32_t LEAF_NODE_RIGHT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) / 2;
-const uint32_t LEAF_NODE_LEFT_SPLIT_COUNT = (LEAF_NODE_MAX_CELLS + 1) - LEAF_NODE_RIGHT_SPLIT_COUNT;
+/* the key of a table is its encoded primary key, the value is the record (see record.h) */
+const uint32_t LEAF_NODE_SPACE_FOR_CELLS = PAGE_USABLE_SIZE - LEAF_NODE_HEADER_SIZE;
+
+// Database Header Layout
+/*
+    Page 0 is not a node: it describes where the btrees of the database live.
+    The table root used to be hardcoded to page 0, now every table and index is
+    registered in the catalog, a btree whose root is recorded here (see catalog.h).
+*/
+const char DB_HEADER_MAGIC[] = "sqlite-clone v7";
+const uint32_t DB_HEADER_MAGIC_SIZE = 16;
+const uint32_t DB_HEADER_CATALOG_ROOT_OFFSET = DB_HEADER_MAGIC_SIZE;
+
+uint32_t *db_header_catalog_root(void *header)
+{
+    return header + DB_HEADER_CATALOG_ROOT_OFFSET;
+}
+
+// Hash Index Layouts (see hash_index.h)
+/* meta page: global depth and the page numbers of the directory */
+const uint32_t HASH_META_GLOBAL_DEPTH_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t HASH_META_NUM_DIRECTORY_PAGES_OFFSET = HASH_META_GLOBAL_DEPTH_OFFSET + sizeof(uint32_t);
+const uint32_t HASH_META_DIRECTORY_PAGES_OFFSET = HASH_META_NUM_DIRECTORY_PAGES_OFFSET + sizeof(uint32_t);
+const uint32_t HASH_META_MAX_DIRECTORY_PAGES = (PAGE_USABLE_SIZE - HASH_META_DIRECTORY_PAGES_OFFSET) / sizeof(uint32_t);
+/* directory page: bucket page numbers */
+const uint32_t HASH_DIRECTORY_ENTRIES_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t HASH_DIRECTORY_ENTRIES_PER_PAGE = (PAGE_USABLE_SIZE - COMMON_NODE_HEADER_SIZE) / sizeof(uint32_t);
+/* bucket page: local depth, number of entries, then (key, leaf page number) entries */
+const uint32_t HASH_BUCKET_LOCAL_DEPTH_OFFSET = COMMON_NODE_HEADER_SIZE;
+const uint32_t HASH_BUCKET_NUM_ENTRIES_OFFSET = HASH_BUCKET_LOCAL_DEPTH_OFFSET + sizeof(uint32_t);
+const uint32_t HASH_BUCKET_HEADER_SIZE = HASH_BUCKET_NUM_ENTRIES_OFFSET + sizeof(uint32_t);
+
+// Computes the size of the cells of a btree from the size of its keys and values.
+NodeLayout make_node_layout(uint32_t key_size, uint32_t value_size)
+{
+    NodeLayout layout;
+    layout.key_size = key_size;
+    layout.value_size = value_size;
+    layout.leaf_cell_size = key_size + value_size;
+    layout.leaf_max_cells = LEAF_NODE_SPACE_FOR_CELLS / layout.leaf_cell_size;
+    layout.leaf_right_split_count = (layout.leaf_max_cells + 1) / 2;
+    layout.leaf_left_split_count = (layout.leaf_max_cells + 1) - layout.leaf_right_split_count;
+    return layout;
+}
+
+Table *table_new(Pager *pager, uint32_t root_page_num, NodeLayout layout)
+{
+    Table *table = malloc(sizeof(Table));
+    table->pager = pager;
+    table->root_page_num = root_page_num;
+    table->layout = layout;
+    table->num_indexes = 0;
+    table->hash_index = NULL;
+    table->name[0] = 0;
+    table->schema.num_columns = 0;
+    table->schema.leaf_format = LEAF_FORMAT_ROWS;
+    table->record_layout.num_columns = 0;
+    table->record_layout.num_key_columns = 0;
+    memset(&(table->stats), 0, sizeof(TreeStats));
+    return table;
+}
+
+// frees the table and the structures of its indexes
+void table_close(Table *table)
+{
+    for (uint32_t i = 0; i < table->num_indexes; i++)
+        index_close(table->indexes[i]);
+    if (table->hash_index != NULL)
+        hash_index_close(table->hash_index);
+    free(table);
+}
+
+// Keys of every btree are encoded so that memcmp gives the right order
+int compare_keys(Table *table, const void *a, const void *b)
+{
+    return memcmp(a, b, table->layout.key_size);
+}
 
 // Pointer to the number of cells in the node
 uint32_t *leaf_node_num_cells(void *node)
@@ -89,19 +162,30 @@ uint32_t *leaf_node_next_leaf(void *node)
     return node + LEAF_NODE_NEXT_LEAF_OFFSET;
 }
 // Pointer to a particular cell (row) in the node
-void *leaf_node_cell(void *node, uint32_t cell_num)
+void *leaf_node_cell(Table *table, void *node, uint32_t cell_num)
 {
-    return node + LEAF_NODE_HEADER_SIZE + cell_num * LEAF_NODE_CELL_SIZE;
+    return node + LEAF_NODE_HEADER_SIZE + cell_num * table->layout.leaf_cell_size;
 }
 // Pointer to the key of a specific cell
-uint32_t *leaf_node_key(void *node, uint32_t cell_num)
+void *leaf_node_key(Table *table, void *node, uint32_t cell_num)
+{
+    if (table->schema.leaf_format == LEAF_FORMAT_ENCODED)
+        return encoded_leaf_key(table, node, cell_num);
+    if (table->schema.leaf_format == LEAF_FORMAT_COLUMNS)
+        return columnar_leaf_key(table, node, cell_num);
+    return leaf_node_cell(table, node, cell_num);
+}
+// Pointer to the value of a specific cell (the values of encoded and columnar leaves are read with cursor_value)
+void *leaf_node_value(Table *table, void *node, uint32_t cell_num)
 {
-    return leaf_node_cell(node, cell_num);
+    return leaf_node_cell(table, node, cell_num) + table->layout.key_size;
 }
-// Pointer to the value of a specific cell
-void *leaf_node_value(void *node, uint32_t cell_num)
+// bytes of the page taken by the header and the cells
+uint32_t leaf_node_used_bytes(Table *table, void *node)
 {
-    return leaf_node_cell(node, cell_num) + LEAF_NODE_KEY_SIZE;
+    if (table->schema.leaf_format == LEAF_FORMAT_ENCODED)
+        return encoded_leaf_size(table, node);
+    return LEAF_NODE_HEADER_SIZE + *leaf_node_num_cells(node) * table->layout.leaf_cell_size;
 }
 // anihilates the value the node pointer is pointing to
 void initialize_leaf_node(void *node)
@@ -121,7 +205,7 @@ NodeType get_node_type(void *node)
 
 void set_node_type(void *node, NodeType type)
 {
-    u_int8_t value = (uint8_t)type;
+    uint8_t value = (uint8_t)type;
     uint8_t *type_slot_ptr = (uint8_t *)(node + NODE_TYPE_OFFSET);
     *type_slot_ptr = value;
 }
@@ -139,12 +223,19 @@ void set_node_root(void *node, bool is_root)
     *is_root_slot = value;
 }
 
+// page number of the parent, meaningless for the root
+uint32_t *node_parent(void *node)
+{
+    return node + PARENT_POINTER_OFFSET;
+}
+
 // anihilates the value the node pointer is pointing to
 void initialize_internal_node(void *node)
 {
     set_node_type(node, NODE_INTERNAL);
     set_node_root(node, false);
     *internal_node_num_keys(node) = 0;
+    *internal_node_prefix_length(node) = 0;
 }
 uint32_t *internal_node_num_keys(void *node)
 {
@@ -155,18 +246,46 @@ uint32_t *internal_node_rightmost_child(void *node)
 {
     return node + INTERNAL_NODE_RIGHTMOST_CHILD_OFFSET;
 }
-// returns the whole cell (id/page number) at index key_num
-uint32_t *internal_node_cell(void *node, uint32_t cell_num)
+// number of bytes every separator of the node starts with
+uint32_t *internal_node_prefix_length(void *node)
+{
+    return node + INTERNAL_NODE_PREFIX_LENGTH_OFFSET;
+}
+// returns the whole cell (page number/key position) at index cell_num
+void *internal_node_cell(Table *table, void *node, uint32_t cell_num)
 {
     return node + INTERNAL_NODE_HEADER_SIZE + cell_num * INTERNAL_NODE_CELL_SIZE;
 }
-// returns the key (id) of the cell at index key_num
-uint32_t *internal_node_key(void *node, uint32_t key_num)
+// the shared prefix of the separators is stored right after the cells
+void *internal_node_prefix(void *node)
+{
+    return node + INTERNAL_NODE_HEADER_SIZE + *internal_node_num_keys(node) * INTERNAL_NODE_CELL_SIZE;
+}
+static uint16_t *internal_node_key_offset(Table *table, void *node, uint32_t key_num)
 {
-    return internal_node_cell(node, key_num) + INTERNAL_NODE_CHILD_SIZE;
+    return internal_node_cell(table, node, key_num) + INTERNAL_NODE_CHILD_SIZE;
 }
-// returns the page number (or key) of the child at a given index in the node
-uint32_t *internal_node_child(void *node, uint32_t child_num)
+// length of the key of the cell at index key_num, without the shared prefix
+uint16_t *internal_node_key_length(Table *table, void *node, uint32_t key_num)
+{
+    return internal_node_cell(table, node, key_num) + INTERNAL_NODE_CHILD_SIZE + INTERNAL_NODE_KEY_OFFSET_SIZE;
+}
+// returns the key of the cell at index key_num, without the shared prefix
+void *internal_node_key(Table *table, void *node, uint32_t key_num)
+{
+    return node + *internal_node_key_offset(table, node, key_num);
+}
+// copies the whole separator at index key_num (prefix included) and returns its length
+uint32_t internal_node_separator(Table *table, void *node, uint32_t key_num, void *separator)
+{
+    uint32_t prefix_length = *internal_node_prefix_length(node);
+    uint32_t key_length = *internal_node_key_length(table, node, key_num);
+    memcpy(separator, internal_node_prefix(node), prefix_length);
+    memcpy(separator + prefix_length, internal_node_key(table, node, key_num), key_length);
+    return prefix_length + key_length;
+}
+// returns the page number of the child at a given index in the node
+uint32_t *internal_node_child(Table *table, void *node, uint32_t child_num)
 {
     uint32_t num_keys = *internal_node_num_keys(node);
     if (child_num > num_keys)
@@ -177,50 +296,47 @@ uint32_t *internal_node_child(void *node, uint32_t child_num)
     else if (child_num == num_keys)
         return internal_node_rightmost_child(node);
     else
-        return internal_node_cell(node, child_num);
+        return internal_node_cell(table, node, child_num);
 }
 
-// returns the highest key in a given node
-uint32_t get_node_max_key(void *node)
+// returns the highest key in a given node.
+// The keys of an internal node only cover its left children, so the max of
+// an internal node is the max of its rightmost child.
+void *get_node_max_key(Table *table, void *node)
 {
     if (get_node_type(node) == NODE_INTERNAL)
     {
-        uint32_t last_cell_index = *internal_node_num_keys(node) - 1;
-        return *internal_node_key(node, last_cell_index);
+        void *rightmost_child = get_page(table->pager, *internal_node_rightmost_child(node));
+        return get_node_max_key(table, rightmost_child);
     }
     else
     {
         uint32_t last_cell_index = *leaf_node_num_cells(node) - 1;
-        return *leaf_node_key(node, last_cell_index);
+        return leaf_node_key(table, node, last_cell_index);
     }
 }
 
-// Magics of C, placing into a destination memory space, related values next
-// to each other, without even caring about their types.
-void serialize_row(Row *source, void *destination)
+// returns the lowest key in a given node, the first key of its leftmost leaf
+void *get_node_min_key(Table *table, void *node)
 {
-    // strncpy instead of memcpy for the char arrays to make sure that bytes are initialized
-    // so it's more readable in the hex editor.
-    memcpy(destination + ID_OFFSET, &(source->id), ID_SIZE);
-    memcpy(destination + USERNAME_OFFSET, &(source->username), USERNAME_SIZE);
-    memcpy(destination + EMAIL_OFFSET, &(source->email), EMAIL_SIZE);
-}
-
-void deserialize_row(void *source, Row *destination)
-{
-    memcpy(&(destination->id), source + ID_OFFSET, ID_SIZE);
-    memcpy(&(destination->username), source + USERNAME_OFFSET, USERNAME_SIZE);
-    memcpy(&(destination->email), source + EMAIL_OFFSET, EMAIL_SIZE);
+    if (get_node_type(node) == NODE_INTERNAL)
+    {
+        void *leftmost_child = get_page(table->pager, *internal_node_child(table, node, 0));
+        return get_node_min_key(table, leftmost_child);
+    }
+    else
+        return leaf_node_key(table, node, 0);
 }
 
-void print_constants()
+// sizes of the nodes of a table, ROW_SIZE being the size of its biggest record
+void print_constants(Table *table)
 {
-    printf("ROW_SIZE: %d\n", ROW_SIZE);
+    printf("ROW_SIZE: %d\n", table->record_layout.max_size);
     printf("COMMON_NODE_HEADER_SIZE: %d\n", COMMON_NODE_HEADER_SIZE);
     printf("LEAF_NODE_HEADER_SIZE: %d\n", LEAF_NODE_HEADER_SIZE);
-    printf("LEAF_NODE_CELL_SIZE: %d\n", LEAF_NODE_CELL_SIZE);
+    printf("LEAF_NODE_CELL_SIZE: %d\n", table->layout.leaf_cell_size);
     printf("LEAF_NODE_SPACE_FOR_CELLS: %d\n", LEAF_NODE_SPACE_FOR_CELLS);
-    printf("LEAF_NODE_MAX_CELLS: %d\n", LEAF_NODE_MAX_CELLS);
+    printf("LEAF_NODE_MAX_CELLS: %d\n", table->layout.leaf_max_cells);
 }
 
 void indent(uint32_t level)
@@ -231,10 +347,50 @@ void indent(uint32_t level)
     }
 }
 
-void print_tree(Pager *pager, uint32_t page_num, uint32_t indentation_level)
+// ids are printed as numbers, index keys start with the (NUL padded) column value.
+// The separators of internal nodes may be truncated: the column they stop in is printed
+// up to there (a bound for numbers, a prefix followed by "..." for text) and the next ones are left out.
+static void print_key(Table *table, void *key, uint32_t length)
 {
-    void *node = get_page(pager, page_num);
+    RecordLayout *record_layout = &(table->record_layout);
+    if (record_layout->num_key_columns == 0)
+    {
+        printf("%.*s\n", (int)strnlen(key, length), (char *)key);
+        return;
+    }
+    // primary key of a table, decoded column by column
+    uint8_t padded[KEY_MAX_SIZE + 2];
+    uint8_t value[RECORD_MAX_SIZE];
+    uint32_t offset = 0;
+    memcpy(padded, key, length);
+    memset(padded + length, 0xFF, table->layout.key_size - length);
+    for (uint32_t i = 0; i < record_layout->num_key_columns && offset < length; i++)
+    {
+        ColumnDescriptor *descriptor = &(record_layout->columns[record_layout->key_columns[i]]);
+        uint32_t size = key_column_size(descriptor->type, descriptor->size);
+        bool truncated = offset + size > length && column_type_is_variable(descriptor->type);
+        if (truncated)
+        {
+            // end the value where the separator ends (a trailing 0x00 would start an escape)
+            uint32_t end = padded[length - 1] == 0 ? length - 1 : length;
+            padded[end] = 0;
+            padded[end + 1] = 1;
+        }
+        if (i > 0)
+            printf(", ");
+        print_value(descriptor->type, value, key_decode_value(descriptor->type, padded + offset, value));
+        if (truncated)
+            printf("...");
+        offset += size;
+    }
+    printf("\n");
+}
+
+void print_tree(Table *table, uint32_t page_num, uint32_t indentation_level)
+{
+    void *node = get_page(table->pager, page_num);
     uint32_t num_keys, child;
+    uint8_t *separator;
 
     switch (get_node_type(node))
     {
@@ -245,44 +401,121 @@ void print_tree(Pager *pager, uint32_t page_num, uint32_t indentation_level)
         for (uint32_t i = 0; i < num_keys; i++)
         {
             indent(indentation_level + 1);
-            printf("- %d\n", *leaf_node_key(node, i));
+            printf("- ");
+            print_key(table, leaf_node_key(table, node, i), table->layout.key_size);
         }
         break;
     case (NODE_INTERNAL):
         num_keys = *internal_node_num_keys(node);
         indent(indentation_level);
         printf("- internal (size %d)\n", num_keys);
+        separator = malloc(table->layout.key_size);
         for (uint32_t i = 0; i < num_keys; i++)
         {
-            child = *internal_node_child(node, i);
-            print_tree(pager, child, indentation_level + 1);
+            child = *internal_node_child(table, node, i);
+            print_tree(table, child, indentation_level + 1);
 
             indent(indentation_level + 1);
-            printf("- key %d\n", *internal_node_key(node, i));
+            printf("- key ");
+            print_key(table, separator, internal_node_separator(table, node, i, separator));
         }
+        free(separator);
         // because we don't have any key for the last child so code above doesn't reach it
         child = *internal_node_rightmost_child(node);
-        print_tree(pager, child, indentation_level + 1);
+        print_tree(table, child, indentation_level + 1);
         break;
+    default:
+        break;
+    }
+}
+
+typedef struct
+{
+    uint64_t nodes[TREE_STATS_MAX_LEVELS];
+    uint64_t leaves;
+    uint64_t leaf_bytes;
+} TreeWalk;
+
+static void tree_walk(Table *table, uint32_t page_num, uint32_t level, TreeWalk *walk)
+{
+    void *node = get_page(table->pager, page_num);
+    if (level < TREE_STATS_MAX_LEVELS)
+        walk->nodes[level]++;
+    if (get_node_type(node) == NODE_LEAF)
+    {
+        walk->leaves++;
+        walk->leaf_bytes += leaf_node_used_bytes(table, node);
+        // no page is held from one leaf to the next, the pool stays within its capacity
+        pager_trim(table->pager);
+        return;
+    }
+    uint32_t num_keys = *internal_node_num_keys(node);
+    for (uint32_t i = 0; i <= num_keys; i++)
+    {
+        // the children may have evicted the node
+        node = get_page(table->pager, page_num);
+        tree_walk(table, *internal_node_child(table, node, i), level + 1, walk);
     }
 }
 
+// Shape of the tree and its split counters, for the .stats meta command.
+// The leaf fill is the share of the leaf pages taken by their header and cells.
+void print_tree_stats(Table *table)
+{
+    TreeWalk walk;
+    memset(&walk, 0, sizeof(TreeWalk));
+    tree_walk(table, table->root_page_num, 0, &walk);
+    uint32_t height = tree_height(table);
+
+    printf("Tree %s:\n", table->name);
+    printf("  height: %d\n", height);
+    for (uint32_t level = 0; level < height && level < TREE_STATS_MAX_LEVELS; level++)
+        printf("  level %d: %lu nodes\n", level, (unsigned long)walk.nodes[level]);
+    printf("  leaf splits: %lu\n", (unsigned long)table->stats.leaf_splits);
+    printf("  internal splits: %lu\n", (unsigned long)table->stats.internal_splits);
+    printf("  leaf fill: %.1f%%\n", 100.0 * walk.leaf_bytes / (walk.leaves * PAGE_USABLE_SIZE));
+}
+
+// number of levels of the tree, a lone root leaf has a height of 1
+uint32_t tree_height(Table *table)
+{
+    uint32_t height = 1;
+    void *node = get_page(table->pager, table->root_page_num);
+    while (get_node_type(node) == NODE_INTERNAL)
+    {
+        node = get_page(table->pager, *internal_node_child(table, node, 0));
+        height++;
+    }
+    return height;
+}
+
 // should really return cell 0 of the leftmost leaf node
 // previous implementation was based on the assumption that the root node is a leaf
-// Even if key 0 does not exist, it will return the leftmost node
+// Now that keys are not necessarily numbers, we simply follow the leftmost children.
 Cursor *table_start(Table *table)
 {
-    Cursor *cursor = table_find(table, 0);
+    uint32_t page_num = table->root_page_num;
+    void *node = get_page(table->pager, page_num);
+    while (get_node_type(node) == NODE_INTERNAL)
+    {
+        page_num = *internal_node_child(table, node, 0);
+        node = get_page(table->pager, page_num);
+    }
 
-    void *node = get_page(table->pager, cursor->page_num);
-    uint32_t num_cells = *leaf_node_num_cells(node);
-    cursor->end_of_table = (num_cells == 0);
+    Cursor *cursor = malloc(sizeof(Cursor));
+    cursor->table = table;
+    cursor->page_num = page_num;
+    cursor->cell_num = 0;
+    cursor->end_of_table = (*leaf_node_num_cells(node) == 0);
 
     return cursor;
 }
 
+// Moving to the next cell is a point where no page pointer is held,
+// so the buffer pool gets a chance to evict pages during long scans.
 void cursor_advance(Cursor *cursor)
 {
+    pager_trim(cursor->table->pager);
     void *node = get_page(cursor->table->pager, cursor->page_num);
     cursor->cell_num += 1;
 
@@ -303,51 +536,83 @@ void cursor_advance(Cursor *cursor)
     }
 }
 
+// returns a pointer to the key of the cell described by the cursor
+void *cursor_key(Cursor *cursor)
+{
+    void *page = get_page(cursor->table->pager, cursor->page_num);
+    if (page == NULL)
+        return NULL;
+    return leaf_node_key(cursor->table, page, cursor->cell_num);
+}
+
 // returns a pointer to the position described by the cursor
 void *cursor_value(Cursor *cursor)
 {
     void *page = get_page(cursor->table->pager, cursor->page_num);
     if (page == NULL)
         return NULL;
-    return leaf_node_value(page, cursor->cell_num);
+    // an encoded or columnar row is rebuilt in the cursor, it stays valid until the next call
+    if (cursor->table->schema.leaf_format == LEAF_FORMAT_ENCODED)
+    {
+        encoded_leaf_record(cursor->table, page, cursor->cell_num, cursor->record);
+        return cursor->record;
+    }
+    if (cursor->table->schema.leaf_format == LEAF_FORMAT_COLUMNS)
+    {
+        columnar_leaf_record(cursor->table, page, cursor->cell_num, cursor->record);
+        return cursor->record;
+    }
+    return leaf_node_value(cursor->table, page, cursor->cell_num);
 }
 
-// Return the position of the given key.
-// If the key is not present, return the position where it should be inserted
-Cursor *table_find(Table *table, u_int32_t key_to_insert)
+// Positions a cursor on the first cell whose key is >= the given key, which is where
+// range and prefix scans start. Unlike tree_find, the cursor never stays one past
+// the last cell of a leaf: it moves on to the next leaf or to the end of the table.
+Cursor *tree_seek(Table *table, const void *key)
 {
-    void *root_node = get_page(table->pager, table->root_page_num);
-    uint32_t root_page_num = table->root_page_num;
+    Cursor *cursor = tree_find(table, key);
+    void *node = get_page(table->pager, cursor->page_num);
 
-    if (get_node_type(root_node) == NODE_LEAF)
-        return leaf_node_find(table, root_page_num, key_to_insert);
-    else
-        return internal_node_find(table, root_page_num, key_to_insert);
+    if (cursor->cell_num >= *leaf_node_num_cells(node))
+    {
+        uint32_t next_page_num = *leaf_node_next_leaf(node);
+        if (next_page_num == 0)
+            cursor->end_of_table = true;
+        else
+        {
+            cursor->page_num = next_page_num;
+            cursor->cell_num = 0;
+        }
+    }
+    return cursor;
 }
 
-Cursor *internal_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert)
+// index of the child whose subtree covers the key
+static uint32_t internal_node_child_index(Table *table, void *node, const void *key)
 {
-    void *node = get_page(table->pager, page_num);
     uint32_t node_num_keys = *internal_node_num_keys(node);
+    uint32_t prefix_length = *internal_node_prefix_length(node);
     int start_i = 0, end_i = node_num_keys - 1, middle_i;
 
+    // every separator starts with the prefix, so unless the key does too they all compare the same way
+    int comparison = memcmp(internal_node_prefix(node), key, prefix_length);
+    if (comparison > 0)
+        end_i = -1;
+    else if (comparison < 0)
+        start_i = node_num_keys;
+
+    // a separator compares as if it was padded with 0xFF: equal bytes mean it is >= the key
+    const void *key_suffix = key + prefix_length;
     while (end_i >= start_i)
     {
         middle_i = (start_i + end_i) / 2;
-        uint32_t middle = *internal_node_key(node, middle_i);
-        if (middle >= key_to_insert)
+        void *middle = internal_node_key(table, node, middle_i);
+        if (memcmp(middle, key_suffix, *internal_node_key_length(table, node, middle_i)) >= 0)
             end_i = middle_i - 1;
         else
             start_i = middle_i + 1;
     }
-
-    uint32_t child_num = *internal_node_child(node, start_i);
-    void *child = get_page(table->pager, child_num);
-
-    if (get_node_type(child) == NODE_LEAF)
-        return leaf_node_find(table, child_num, key_to_insert);
-    else
-        return internal_node_find(table, child_num, key_to_insert);
+    return start_i;
 }
 
 /*
@@ -356,9 +621,8 @@ Cursor *internal_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_in
     • the position of another key that we’ll need to move if we want to insert the new key
     • the position one past the last key if it's in the end
 */
-Cursor *leaf_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert)
+static Cursor *leaf_node_search(Table *table, uint32_t page_num, void *node, const void *key)
 {
-    void *node = get_page(table->pager, page_num);
     uint32_t node_num_cells = *leaf_node_num_cells(node);
     Cursor *cursor = malloc(sizeof(Cursor));
     cursor->table = table;
@@ -370,14 +634,14 @@ Cursor *leaf_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert
     while (end_i >= start_i)
     {
         middle_i = (start_i + end_i) / 2;
-        uint32_t cell_key = *leaf_node_key(node, middle_i);
+        int comparison = compare_keys(table, leaf_node_key(table, node, middle_i), key);
 
-        if (cell_key == key_to_insert)
+        if (comparison == 0)
         {
             cursor->cell_num = middle_i;
             return cursor;
         }
-        else if (cell_key > key_to_insert)
+        else if (comparison > 0)
             end_i = middle_i - 1;
         else
             start_i = middle_i + 1;
@@ -387,14 +651,76 @@ Cursor *leaf_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert
     return cursor;
 }
 
-// creates a cell(key, value(serialized row)) and inserts it at the correct position
+Cursor *leaf_node_find(Table *table, uint32_t page_num, const void *key)
+{
+    return leaf_node_search(table, page_num, get_page(table->pager, page_num), key);
+}
+
+// Descends from a node to the leaf that covers the key. A child is reached with get_child_page:
+// once it is resident, it is a pointer kept in the frame of its parent, not a page table lookup.
+static Cursor *node_find(Table *table, uint32_t page_num, void *node, const void *key)
+{
+    while (get_node_type(node) == NODE_INTERNAL)
+    {
+        uint32_t child_index = internal_node_child_index(table, node, key);
+        page_num = *internal_node_child(table, node, child_index);
+        node = get_child_page(table->pager, node, child_index, page_num);
+    }
+    return leaf_node_search(table, page_num, node, key);
+}
+
+Cursor *internal_node_find(Table *table, uint32_t page_num, const void *key)
+{
+    return node_find(table, page_num, get_page(table->pager, page_num), key);
+}
+
+// Return the position of the given key in the btree (table or index).
+// If the key is not present, return the position where it should be inserted
+Cursor *tree_find(Table *table, const void *key)
+{
+    return node_find(table, table->root_page_num, get_page(table->pager, table->root_page_num), key);
+}
+
+static void encoded_leaf_node_insert(Cursor *cursor, const void *key, const void *value);
+static void leaf_node_finish_split(Table *table, uint32_t old_page_num, uint32_t new_page_num);
+
+// Moves a row from a cell to another, the cells of a columnar leaf are spread over its minipages
+static void leaf_node_copy_cell(Table *table, void *destination, uint32_t destination_num, void *source,
+                                uint32_t source_num)
+{
+    if (table->schema.leaf_format == LEAF_FORMAT_COLUMNS)
+        columnar_leaf_copy(table, destination, destination_num, source, source_num);
+    else
+        memcpy(leaf_node_cell(table, destination, destination_num), leaf_node_cell(table, source, source_num),
+               table->layout.leaf_cell_size);
+}
+
+static void leaf_node_write_cell(Table *table, void *node, uint32_t cell_num, const void *key, const void *value)
+{
+    if (table->schema.leaf_format == LEAF_FORMAT_COLUMNS)
+        columnar_leaf_write(table, node, cell_num, key, value);
+    else
+    {
+        memcpy(leaf_node_key(table, node, cell_num), key, table->layout.key_size);
+        memcpy(leaf_node_value(table, node, cell_num), value, table->layout.value_size);
+    }
+}
+
+// creates a cell(key, value) and inserts it at the correct position
 // if the position is in the middle of existing nodes, shift them to the right
-void leaf_node_insert(Cursor *cursor, uint32_t key, Row *value)
+void leaf_node_insert(Cursor *cursor, const void *key, const void *value)
 {
-    void *node = get_page(cursor->table->pager, cursor->page_num);
+    Table *table = cursor->table;
+    void *node = get_page_for_write(table->pager, cursor->page_num);
+
+    if (table->schema.leaf_format == LEAF_FORMAT_ENCODED)
+    {
+        encoded_leaf_node_insert(cursor, key, value);
+        return;
+    }
 
     uint32_t node_num_cells = *leaf_node_num_cells(node);
-    if (node_num_cells >= LEAF_NODE_MAX_CELLS)
+    if (node_num_cells >= table->layout.leaf_max_cells)
     {
         leaf_node_split_and_insert(cursor, key, value);
         return;
@@ -404,10 +730,7 @@ void leaf_node_insert(Cursor *cursor, uint32_t key, Row *value)
     {
         // Make room for new cell
         for (uint32_t i = node_num_cells; i > cursor->cell_num; i--)
-        {
-            memcpy(leaf_node_cell(node, i), leaf_node_cell(node, i - 1),
-                   LEAF_NODE_CELL_SIZE);
-        }
+            leaf_node_copy_cell(table, node, i, node, i - 1);
     }
     // ex: node_num_cells = 10, cell_num = 7
     // so position in cells ranging from [[0, 9] * LEAF_NODE_CELL_SIZE]
@@ -415,21 +738,23 @@ void leaf_node_insert(Cursor *cursor, uint32_t key, Row *value)
     // if cursor->cell_num = node_num_cells <=> 8 == 8, the 8 cell slot is empty because [0, 7] are occupied
 
     *(leaf_node_num_cells(node)) += 1;
-    *(leaf_node_key(node, cursor->cell_num)) = key;
-    serialize_row(value, leaf_node_value(node, cursor->cell_num));
+    leaf_node_write_cell(table, node, cursor->cell_num, key, value);
 }
 
-void leaf_node_split_and_insert(Cursor *cursor, uint32_t key, Row *value)
+void leaf_node_split_and_insert(Cursor *cursor, const void *key, const void *value)
 {
     /*
         Create a new node and move half the cells over.
         Insert the new value in one of the two nodes.
         Update parent or create a new parent.
     */
-    void *old_node = get_page(cursor->table->pager, cursor->page_num);
-    uint32_t new_page_num = get_unused_page_num(cursor->table->pager);
-    void *new_node = get_page(cursor->table->pager, new_page_num);
+    Table *table = cursor->table;
+    NodeLayout *layout = &table->layout;
+    void *old_node = get_page_for_write(table->pager, cursor->page_num);
+    uint32_t new_page_num = get_unused_page_num(table->pager);
+    void *new_node = get_page_for_write(table->pager, new_page_num);
     initialize_leaf_node(new_node);
+    *node_parent(new_node) = *node_parent(old_node);
     *leaf_node_next_leaf(new_node) = *leaf_node_next_leaf(old_node);
     *leaf_node_next_leaf(old_node) = new_page_num;
     /*
@@ -438,32 +763,47 @@ void leaf_node_split_and_insert(Cursor *cursor, uint32_t key, Row *value)
         evenly between old (left) and new (right) nodes.
         Starting from the right, move each key to correct position.
     */
-    for (int32_t i = LEAF_NODE_MAX_CELLS; i >= 0; i--)
+    for (int32_t i = layout->leaf_max_cells; i >= 0; i--)
     {
         void *destination_node;
 
-        if (i >= LEAF_NODE_LEFT_SPLIT_COUNT)
+        if (i >= layout->leaf_left_split_count)
             destination_node = new_node;
         else
             destination_node = old_node;
 
-        uint32_t index_within_node = i % LEAF_NODE_LEFT_SPLIT_COUNT;
-        void *destination_cell = leaf_node_cell(destination_node, index_within_node);
+        uint32_t index_within_node = i % layout->leaf_left_split_count;
 
         if (i == cursor->cell_num)
-        {
-            serialize_row(value, leaf_node_value(destination_node, index_within_node));
-            *leaf_node_key(destination_node, index_within_node) = key;
-        }
+            leaf_node_write_cell(table, destination_node, index_within_node, key, value);
         else if (i > cursor->cell_num)
-            memcpy(destination_cell, leaf_node_cell(old_node, i - 1), LEAF_NODE_CELL_SIZE);
+            leaf_node_copy_cell(table, destination_node, index_within_node, old_node, i - 1);
         else
-            memcpy(destination_cell, leaf_node_cell(old_node, i), LEAF_NODE_CELL_SIZE);
+            leaf_node_copy_cell(table, destination_node, index_within_node, old_node, i);
     }
 
     /* Update cell count on both leaf nodes */
-    *(leaf_node_num_cells(old_node)) = LEAF_NODE_LEFT_SPLIT_COUNT;
-    *(leaf_node_num_cells(new_node)) = LEAF_NODE_RIGHT_SPLIT_COUNT;
+    *(leaf_node_num_cells(old_node)) = layout->leaf_left_split_count;
+    *(leaf_node_num_cells(new_node)) = layout->leaf_right_split_count;
+
+    leaf_node_finish_split(table, cursor->page_num, new_page_num);
+}
+
+// Once the rows of a leaf are divided between it and its new right sibling,
+// the rows that moved and the new leaf have to be found from above.
+static void leaf_node_finish_split(Table *table, uint32_t old_page_num, uint32_t new_page_num)
+{
+    void *old_node = get_page(table->pager, old_page_num);
+    void *new_node = get_page(table->pager, new_page_num);
+    table->stats.leaf_splits++;
+    TRACE_INSTANT(TRACE_LEAF_SPLIT, old_page_num);
+
+    /* The hash index points to the leaf of every row, the right half now lives in the new leaf */
+    if (table->hash_index != NULL)
+    {
+        for (uint32_t i = 0; i < *leaf_node_num_cells(new_node); i++)
+            hash_index_set_page(table->hash_index, leaf_node_key(table, new_node, i), new_page_num);
+    }
 
     /*
         Then we need to update the node's parent.
@@ -471,213 +811,343 @@ void leaf_node_split_and_insert(Cursor *cursor, uint32_t key, Row *value)
         In that case, create a new root node to act as the parent.
     */
     if (is_node_root(old_node))
-        return create_new_root(cursor->table, new_page_num);
+        create_new_root(table, new_page_num);
     else
-    {
-        printf("Need to implement updating parent after split\n");
-        exit(EXIT_FAILURE);
-    }
-}
-
-void create_new_root(Table *table, uint32_t right_child_page_num)
-{
-    /*
-        Handle splitting the root.
-        Old root copied to new page, becomes left child.
-        Address of right child passed in.
-        Re-initialize root page to contain the new root node.
-        New root node points to two children.
-    */
-    void *root = get_page(table->pager, table->root_page_num);
-    uint32_t left_child_page_num = get_unused_page_num(table->pager);
-    void *left_child = get_page(table->pager, left_child_page_num);
-
-    /* Left child has data copied from old root */
-    memcpy(left_child, root, PAGE_SIZE);
-    set_node_root(left_child, false);
-
-    /* Root node is a new internal node with one key and two children */
-    initialize_internal_node(root);
-    set_node_root(root, true);
-    *internal_node_num_keys(root) = 1;
-    *internal_node_child(root, 0) = left_child_page_num;
-    uint32_t left_child_max_key = get_node_max_key(left_child);
-    *internal_node_key(root, 0) = left_child_max_key;
-    *internal_node_rightmost_child(root) = right_child_page_num;
+        internal_node_insert(table, *node_parent(old_node), old_page_num, new_page_num);
 }
 
 /*
-    Until we start recycling free pages, new pages will always
-    go onto the end of the database file.
-    Page 0 is the only page that is sort of reserved to the root node.
+    Encoded leaves have no fixed number of cells: the rows are decoded, the new one is added and
+    they are encoded again. When they don't fit anymore, they are divided between the leaf and a
+    new one, as evenly as the sizes of the two halves allow.
 */
-uint32_t get_unused_page_num(Pager *pager) { return pager->num_pages; }
-
-// Attempts to get the page from pager (cache).
-// if miss, allocates memory for this page and returns it.
-// writing to the disk file does not happen here yet.
-void *get_page(Pager *pager, uint32_t page_num)
+static void encoded_leaf_node_insert(Cursor *cursor, const void *key, const void *value)
 {
-    if (page_num > TABLE_MAX_PAGES)
+    Table *table = cursor->table;
+    void *old_node = get_page_for_write(table->pager, cursor->page_num);
+    LeafRows *rows = encoded_leaf_read(table, old_node);
+    leaf_rows_insert(table, rows, cursor->cell_num, key, value);
+    if (encoded_leaf_write(table, old_node, rows, 0, rows->num_rows))
     {
-        printf("Tried to fetch page number out of bounds. %d > %d\n", page_num,
-               TABLE_MAX_PAGES);
-        return NULL;
+        leaf_rows_free(rows);
+        return;
     }
 
-    if (pager->pages[page_num] == NULL)
-    {
-        // Cache miss. Allocate memory and load from file.
-        void *page = malloc(PAGE_SIZE);
-        pager->pages[page_num] = page;
+    uint32_t new_page_num = get_unused_page_num(table->pager);
+    void *new_node = get_page_for_write(table->pager, new_page_num);
+    initialize_leaf_node(new_node);
+    *node_parent(new_node) = *node_parent(old_node);
+    *leaf_node_next_leaf(new_node) = *leaf_node_next_leaf(old_node);
+    *leaf_node_next_leaf(old_node) = new_page_num;
 
-        // why ?
-        if (page_num >= pager->num_pages)
+    // The split point moves away from the middle until both halves fit. The new leaf is written
+    // first so the old one keeps its rows until a split point works.
+    bool split = false;
+    for (uint32_t distance = 0; !split && distance < rows->num_rows; distance++)
+    {
+        for (int32_t sign = 1; !split && sign >= (distance == 0 ? 1 : -1); sign -= 2)
         {
-            pager->num_pages = page_num + 1;
+            int32_t left_count = (int32_t)rows->num_rows / 2 + sign * (int32_t)distance;
+            if (left_count < 1 || left_count >= (int32_t)rows->num_rows)
+                continue;
+            split = encoded_leaf_write(table, new_node, rows, left_count, rows->num_rows - left_count) &&
+                    encoded_leaf_write(table, old_node, rows, 0, left_count);
         }
+    }
+    leaf_rows_free(rows);
+    if (!split)
+    {
+        printf("Rows too large to split leaf %d.\n", cursor->page_num);
+        exit(EXIT_FAILURE);
+    }
 
-        uint32_t file_num_pages = pager->file_length / PAGE_SIZE;
+    leaf_node_finish_split(table, cursor->page_num, new_page_num);
+}
 
-        // We have the data for the given page in the file, so we load the cache page with it
-        if (page_num <= file_num_pages)
-        {
-            // changes the location of the read/write pointer of the file descriptor
-            lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
-            // attempts to read from it
-            ssize_t bytes_read = read(pager->file_descriptor, page, PAGE_SIZE);
-            if (bytes_read == -1)
-            {
-                printf("Error reading file: %d\n", errno);
-                return NULL;
-            }
-        }
+// The separators of an internal node written out in full, so the node can be laid out again
+// around a new cell: their shared prefix changes with them.
+typedef struct
+{
+    uint32_t num_keys;
+    uint32_t rightmost_child;
+    uint32_t *children;
+    uint32_t *lengths;
+    uint8_t *separators; /* the separator of cell i starts at i * key_size */
+} InternalCells;
+
+// reads the cells of a node, with room for one more
+static InternalCells *internal_cells_read(Table *table, void *node)
+{
+    uint32_t num_keys = *internal_node_num_keys(node);
+    uint32_t key_size = table->layout.key_size;
+    InternalCells *cells = malloc(sizeof(InternalCells));
+    cells->num_keys = num_keys;
+    cells->rightmost_child = *internal_node_rightmost_child(node);
+    cells->children = malloc((num_keys + 1) * sizeof(uint32_t));
+    cells->lengths = malloc((num_keys + 1) * sizeof(uint32_t));
+    cells->separators = malloc((num_keys + 1) * key_size);
+    for (uint32_t i = 0; i < num_keys; i++)
+    {
+        cells->children[i] = *internal_node_child(table, node, i);
+        cells->lengths[i] = internal_node_separator(table, node, i, cells->separators + i * key_size);
     }
+    return cells;
+}
 
-    return pager->pages[page_num];
+static void internal_cells_free(InternalCells *cells)
+{
+    free(cells->children);
+    free(cells->lengths);
+    free(cells->separators);
+    free(cells);
 }
 
-/* Opening the database file
-initializing a pager data structure
-initializing a table data structure */
-Table *db_open(const char *filename)
+/*
+    Shortest separator between two neighbour subtrees: the bytes of the max key of the left one
+    up to the first one that differs from the min key of the right one. Padded with 0xFF it is
+    >= max(left) and its last byte is lower than the one of min(right).
+*/
+static uint32_t make_separator(Table *table, uint32_t left_page_num, uint32_t right_page_num, void *separator)
 {
-    Pager *pager = pager_open(filename);
+    uint8_t *left_max_key = get_node_max_key(table, get_page(table->pager, left_page_num));
+    uint8_t *right_min_key = get_node_min_key(table, get_page(table->pager, right_page_num));
+    uint32_t length = 1;
+    while (length < table->layout.key_size && left_max_key[length - 1] == right_min_key[length - 1])
+        length++;
+    memcpy(separator, left_max_key, length);
+    return length;
+}
 
-    Table *table = malloc(sizeof(Table));
-    table->pager = pager;
-    // why would that be 0 ?
-    table->root_page_num = 0;
+/*
+    Adds new_child right after left_child, which just split into the two of them.
+    Before: [... (left, K) ...]          K separates left from its right neighbour
+    After:  [... (left, S) (new, K) ...] S separates left from new
+    When left was the rightmost child, it gets a cell and new becomes the rightmost child.
+*/
+static void internal_cells_insert(Table *table, InternalCells *cells, uint32_t left_child_page_num,
+                                  uint32_t new_child_page_num)
+{
+    uint32_t key_size = table->layout.key_size;
+    uint32_t index = 0;
+    while (index < cells->num_keys && cells->children[index] != left_child_page_num)
+        index++;
 
-    if (pager->num_pages == 0)
+    if (index == cells->num_keys)
+        cells->rightmost_child = new_child_page_num;
+    else
     {
-        // New database file. Initialize page 0 as leaf node.
-        void *root_node = get_page(pager, 0);
-        initialize_leaf_node(root_node);
-        set_node_root(root_node, true);
+        // shift the cells on the right of left_child, the old key of left_child moves with new_child
+        uint32_t num_moved = cells->num_keys - index;
+        memmove(cells->children + index + 1, cells->children + index, num_moved * sizeof(uint32_t));
+        memmove(cells->lengths + index + 1, cells->lengths + index, num_moved * sizeof(uint32_t));
+        memmove(cells->separators + (index + 1) * key_size, cells->separators + index * key_size,
+                num_moved * key_size);
+        cells->children[index + 1] = new_child_page_num;
     }
-
-    return table;
+    cells->num_keys++;
+    cells->children[index] = left_child_page_num;
+    cells->lengths[index] = make_separator(table, left_child_page_num, new_child_page_num,
+                                           cells->separators + index * key_size);
 }
 
-// Opens the database file and keeps track of its size. It also initializes the page cache to all NULLs.
-Pager *pager_open(const char *filename)
+// length of the prefix shared by the separators of the cells [first, first + count)
+static uint32_t internal_cells_prefix_length(Table *table, InternalCells *cells, uint32_t first, uint32_t count)
 {
-    int fd = open(filename,
-                  O_RDWR |     // Read/Write mode
-                      O_CREAT, // Create file if it does not exist
-                  S_IWUSR |    // User write permission
-                      S_IRUSR  // User read permission
-    );
+    uint32_t key_size = table->layout.key_size;
+    uint8_t *separators = cells->separators + first * key_size;
+    uint32_t *lengths = cells->lengths + first;
 
-    if (fd == -1)
+    uint32_t prefix_length = count > 0 ? lengths[0] : 0;
+    for (uint32_t i = 1; i < count; i++)
     {
-        printf("Unable to open file\n");
-        exit(EXIT_FAILURE);
+        uint32_t length = 0;
+        while (length < prefix_length && length < lengths[i] && separators[length] == separators[i * key_size + length])
+            length++;
+        prefix_length = length;
     }
+    return prefix_length;
+}
 
-    /* SEEK_END: set file offset to EndOfFile plus offset */
-    off_t file_length = lseek(fd, 0, SEEK_END);
-
-    Pager *pager = malloc(sizeof(Pager));
-    pager->file_descriptor = fd;
-    pager->file_length = file_length;
-    pager->num_pages = (file_length / PAGE_SIZE);
+// bytes taken by a node holding the cells [first, first + count)
+static uint32_t internal_cells_size(Table *table, InternalCells *cells, uint32_t first, uint32_t count)
+{
+    uint32_t prefix_length = internal_cells_prefix_length(table, cells, first, count);
+    uint32_t size = INTERNAL_NODE_HEADER_SIZE + count * INTERNAL_NODE_CELL_SIZE + prefix_length;
+    for (uint32_t i = 0; i < count; i++)
+        size += cells->lengths[first + i] - prefix_length;
+    return size;
+}
 
-    if (file_length % PAGE_SIZE != 0)
+/*
+    Lays out the cells [first, first + count) and the rightmost child in the node: the cells,
+    the prefix shared by their separators, then what remains of each separator.
+    Returns false without touching the node if they don't fit in a page.
+*/
+static bool internal_node_write(Table *table, void *node, InternalCells *cells, uint32_t first, uint32_t count,
+                                uint32_t rightmost_child)
+{
+    uint32_t key_size = table->layout.key_size;
+    uint8_t *separators = cells->separators + first * key_size;
+    uint32_t *lengths = cells->lengths + first;
+
+    if (internal_cells_size(table, cells, first, count) > PAGE_USABLE_SIZE)
+        return false;
+    uint32_t prefix_length = internal_cells_prefix_length(table, cells, first, count);
+
+    *internal_node_num_keys(node) = count;
+    *internal_node_rightmost_child(node) = rightmost_child;
+    *internal_node_prefix_length(node) = prefix_length;
+    memcpy(internal_node_prefix(node), separators, prefix_length);
+    uint32_t offset = (internal_node_prefix(node) - node) + prefix_length;
+    for (uint32_t i = 0; i < count; i++)
     {
-        printf("Db file is not a whole number of pages. Corrupt file.\n");
-        exit(EXIT_FAILURE);
+        *internal_node_child(table, node, i) = cells->children[first + i];
+        *internal_node_key_offset(table, node, i) = offset;
+        *internal_node_key_length(table, node, i) = lengths[i] - prefix_length;
+        memcpy(node + offset, separators + i * key_size + prefix_length, lengths[i] - prefix_length);
+        offset += lengths[i] - prefix_length;
     }
+    return true;
+}
 
-    // cache
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+// Called after left_child split, new_child being its new right sibling
+void internal_node_insert(Table *table, uint32_t parent_page_num, uint32_t left_child_page_num,
+                          uint32_t new_child_page_num)
+{
+    void *parent = get_page_for_write(table->pager, parent_page_num);
+    InternalCells *cells = internal_cells_read(table, parent);
+    internal_cells_insert(table, cells, left_child_page_num, new_child_page_num);
+    bool fits = internal_node_write(table, parent, cells, 0, cells->num_keys, cells->rightmost_child);
+    internal_cells_free(cells);
+
+    if (!fits)
     {
-        pager->pages[i] = NULL;
+        internal_node_split_and_insert(table, parent_page_num, left_child_page_num, new_child_page_num);
+        return;
     }
-
-    return pager;
+    *node_parent(get_page_for_write(table->pager, new_child_page_num)) = parent_page_num;
 }
 
 /*
-For now, we’ll wait to flush the cache to disk until the user closes the connection to the database:
-• flushes the page cache to disk
-• closes the database file
-• frees the memory for the Pager and Table data structures */
-void db_close(Table *table)
+    Number of cells of the left half of a split: cells [0, n) go left, cell n gives its child to
+    the left node as rightmost child, and the cells after it go right. Both halves have to fit,
+    and a count in the middle is not enough: each half is laid out with its own shared prefix,
+    a long one can save far more bytes on one side than on the other. The split point closest
+    to the middle where both fit is taken.
+*/
+static uint32_t internal_cells_split_point(Table *table, InternalCells *cells)
 {
-    Pager *pager = table->pager;
-
-    for (uint32_t i = 0; i < pager->num_pages; i++)
+    // both nodes keep at least one key
+    uint32_t total_keys = cells->num_keys;
+    uint32_t middle = total_keys / 2;
+    for (uint32_t i = 0; i < 2 * total_keys; i++)
     {
-        if (pager->pages[i] == NULL)
-        {
-            continue; /* not overriding file pages */
-        }
-        pager_flush(pager, i);
+        // middle, middle - 1, middle + 1, middle - 2...
+        uint32_t left_num_keys = i % 2 == 0 ? middle - i / 2 : middle + (i + 1) / 2;
+        if (left_num_keys < 1 || left_num_keys + 2 > total_keys)
+            continue;
+        if (internal_cells_size(table, cells, 0, left_num_keys) <= PAGE_USABLE_SIZE &&
+            internal_cells_size(table, cells, left_num_keys + 1, total_keys - left_num_keys - 1) <= PAGE_USABLE_SIZE)
+            return left_num_keys;
     }
+    return middle;
+}
 
-    if ((close(pager->file_descriptor)) == -1)
+void internal_node_split_and_insert(Table *table, uint32_t page_num, uint32_t left_child_page_num,
+                                    uint32_t new_child_page_num)
+{
+    /*
+        Same idea as splitting a leaf: the cells of the full node plus the new cell are divided
+        between the old (left) and a new (right) node, each laid out with its own prefix.
+        The middle child becomes the rightmost child of the left node, so its key is not
+        needed anymore: the parent will hold a separator between the two nodes instead.
+    */
+    Pager *pager = table->pager;
+    table->stats.internal_splits++;
+    TRACE_BEGIN(TRACE_INTERNAL_SPLIT, page_num);
+    void *old_node = get_page_for_write(pager, page_num);
+    InternalCells *cells = internal_cells_read(table, old_node);
+    internal_cells_insert(table, cells, left_child_page_num, new_child_page_num);
+    *node_parent(get_page_for_write(pager, new_child_page_num)) = page_num;
+
+    uint32_t total_keys = cells->num_keys;
+    uint32_t left_num_keys = internal_cells_split_point(table, cells);
+    uint32_t right_num_keys = total_keys - left_num_keys - 1;
+
+    uint32_t new_page_num = get_unused_page_num(pager);
+    void *new_node = get_page_for_write(pager, new_page_num);
+    initialize_internal_node(new_node);
+    *node_parent(new_node) = *node_parent(old_node);
+
+    if (!internal_node_write(table, new_node, cells, left_num_keys + 1, right_num_keys, cells->rightmost_child) ||
+        !internal_node_write(table, old_node, cells, 0, left_num_keys, cells->children[left_num_keys]))
     {
-        printf("Error closing db file.\n");
+        printf("Separators too large to split internal node %d.\n", page_num);
         exit(EXIT_FAILURE);
     }
-    for (uint32_t i = 0; i < TABLE_MAX_PAGES; i++)
+    internal_cells_free(cells);
+
+    // the children that moved to the new node have a new parent
+    for (uint32_t i = 0; i <= right_num_keys; i++)
     {
-        void *page = pager->pages[i];
-        if (page)
-        {
-            free(page);
-            pager->pages[i] = NULL;
-        }
+        void *child = get_page_for_write(pager, *internal_node_child(table, new_node, i));
+        *node_parent(child) = new_page_num;
     }
-    free(pager);
-    free(table);
+
+    if (is_node_root(old_node))
+        create_new_root(table, new_page_num);
+    else
+        internal_node_insert(table, *node_parent(old_node), page_num, new_page_num);
+    TRACE_END(TRACE_INTERNAL_SPLIT, page_num);
 }
 
-void pager_flush(Pager *pager, uint32_t page_num)
+void create_new_root(Table *table, uint32_t right_child_page_num)
 {
-    if (pager->pages[page_num] == NULL)
-    {
-        printf("Tried to flush null page\n");
-        exit(EXIT_FAILURE);
-    }
+    /*
+        Handle splitting the root.
+        Old root copied to new page, becomes left child.
+        Address of right child passed in.
+        Re-initialize root page to contain the new root node.
+        New root node points to two children.
+    */
+    TRACE_INSTANT(TRACE_NEW_ROOT, table->root_page_num);
+    void *root = get_page_for_write(table->pager, table->root_page_num);
+    void *right_child = get_page_for_write(table->pager, right_child_page_num);
+    uint32_t left_child_page_num = get_unused_page_num(table->pager);
+    void *left_child = get_page_for_write(table->pager, left_child_page_num);
 
-    // places the file pointer to where we need to write
-    off_t offset = lseek(pager->file_descriptor, page_num * PAGE_SIZE, SEEK_SET);
+    /* Left child has data copied from old root */
+    memcpy(left_child, root, PAGE_SIZE);
+    set_node_root(left_child, false);
 
-    if (offset == -1)
+    /* The children of the old root have moved with it, or its rows if it was a leaf */
+    if (get_node_type(left_child) == NODE_INTERNAL)
     {
-        printf("Error seeking: %d\n", errno);
-        exit(EXIT_FAILURE);
+        for (uint32_t i = 0; i <= *internal_node_num_keys(left_child); i++)
+        {
+            void *child = get_page_for_write(table->pager, *internal_node_child(table, left_child, i));
+            *node_parent(child) = left_child_page_num;
+        }
+    }
+    else if (table->hash_index != NULL)
+    {
+        for (uint32_t i = 0; i < *leaf_node_num_cells(left_child); i++)
+            hash_index_set_page(table->hash_index, leaf_node_key(table, left_child, i), left_child_page_num);
     }
 
-    ssize_t bytes_written =
-        write(pager->file_descriptor, pager->pages[page_num], PAGE_SIZE);
-
-    if (bytes_written == -1)
+    /* Root node is a new internal node with one key and two children */
+    uint8_t *separator = malloc(table->layout.key_size);
+    uint32_t separator_length = make_separator(table, left_child_page_num, right_child_page_num, separator);
+    InternalCells cells = {1, right_child_page_num, &left_child_page_num, &separator_length, separator};
+    initialize_internal_node(root);
+    set_node_root(root, true);
+    // a single separator is at most KEY_MAX_SIZE bytes, far less than a page
+    if (!internal_node_write(table, root, &cells, 0, 1, right_child_page_num))
     {
-        printf("Error writing: %d\n", errno);
+        printf("Separator too large for the new root.\n");
         exit(EXIT_FAILURE);
     }
-}
\ No newline at end of file
+    free(separator);
+    *node_parent(left_child) = table->root_page_num;
+    *node_parent(right_child) = table->root_page_num;
+}
@@ -1,5 +1,8 @@
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdint.h>
+#include "pager.h"
+#include "record.h"
 
 #ifndef TABLE_HEADER
 #define TABLE_HEADER
@@ -7,45 +10,51 @@
 // general purpose macros
 #define size_of_attribute(Struct, Attribute) sizeof(((Struct *)0)->Attribute)
 
-// table attributes / rows
-#define COLUMN_USERNAME_SIZE 32
-#define COLUMN_EMAIL_SIZE 255
-
-extern const uint32_t ID_SIZE;
-extern const uint32_t USERNAME_SIZE;
-extern const uint32_t EMAIL_SIZE;
-
-extern const uint32_t ID_OFFSET;
-extern const uint32_t USERNAME_OFFSET;
-extern const uint32_t EMAIL_OFFSET;
-extern const uint32_t ROW_SIZE;
+// Secondary indexes are defined in index.h
+typedef struct Index Index;
+// Hash index on the ids is defined in hash_index.h
+typedef struct HashIndex HashIndex;
+#define TABLE_MAX_INDEXES 4
 
+// Describes the cells of every node of a given btree.
+// The table stores (primary key -> record) but an index stores (column value + primary key -> primary key),
+// so sizes can't be global constants anymore. Keys are always compared with memcmp (see record.h).
 typedef struct
 {
-  uint32_t id;                             /* 32b = 4B */
-  char username[COLUMN_USERNAME_SIZE + 1]; /* 32 * 1B + null terminator (1B) = 32B */
-  char email[COLUMN_EMAIL_SIZE + 1];       /* 255 * 1B + null terminator (1B) = 255B */
-} Row;                                     /* 32(+1) + 4 + 255(+1) = 293B */
+  uint32_t key_size;
+  uint32_t value_size;
+  uint32_t leaf_cell_size;
+  uint32_t leaf_max_cells;
+  uint32_t leaf_right_split_count;
+  uint32_t leaf_left_split_count;
+} NodeLayout;
 
-// Table and Pages
-#define TABLE_MAX_PAGES 100
-extern const uint32_t PAGE_SIZE;
+#define TREE_STATS_MAX_LEVELS 16
 
-// Structure used by a table to access the file of the table (file descriptor).
-// Or to load the data from memory (pager)
+// Structural changes of a btree since the database was opened (see .stats)
 typedef struct
 {
-  int file_descriptor;
-  uint32_t file_length;
-  uint32_t num_pages;
-  void *pages[TABLE_MAX_PAGES];
-} Pager;
+  uint64_t leaf_splits;
+  uint64_t internal_splits;
+} TreeStats;
 
 typedef struct
 {
   // A btree is identified by its root node page number, so the table object needs to keep track of that
   uint32_t root_page_num;
   Pager *pager;
+  NodeLayout layout;
+  // name and columns of a user table, as registered in the catalog
+  char name[TABLE_NAME_SIZE + 1];
+  Schema schema;
+  RecordLayout record_layout; /* compiled from the schema, the values of the btree are records */
+  uint32_t minipage_offsets[TABLE_MAX_COLUMNS]; /* in the leaves of a columnar table */
+  // secondary indexes to maintain on insert (always 0 for the btree of an index)
+  uint32_t num_indexes;
+  Index *indexes[TABLE_MAX_INDEXES];
+  // optional hash index on the ids, NULL if there is none
+  HashIndex *hash_index;
+  TreeStats stats;
 } Table;
 
 // Used for search, insertion and every other operation on the table
@@ -55,13 +64,17 @@ typedef struct
   uint32_t page_num;
   uint32_t cell_num;
   bool end_of_table;
+  uint8_t record[RECORD_MAX_SIZE]; /* row rebuilt by cursor_value when the leaves are not made of cells */
 } Cursor;
 
 // Nodes
 typedef enum
 {
   NODE_INTERNAL,
-  NODE_LEAF
+  NODE_LEAF,
+  NODE_HASH_META,
+  NODE_HASH_DIRECTORY,
+  NODE_HASH_BUCKET
 } NodeType;
 
 // Common Node Header Layout
@@ -79,29 +92,43 @@ extern const uint32_t INTERNAL_NODE_NUM_KEYS_OFFSET;
 // page number of its rightmost child
 extern const uint32_t INTERNAL_NODE_RIGHTMOST_CHILD_SIZE;
 extern const uint32_t INTERNAL_NODE_RIGHTMOST_CHILD_OFFSET;
+// number of bytes shared by all the separators of the node
+extern const uint32_t INTERNAL_NODE_PREFIX_LENGTH_SIZE;
+extern const uint32_t INTERNAL_NODE_PREFIX_LENGTH_OFFSET;
 extern const uint32_t INTERNAL_NODE_HEADER_SIZE;
 
 // Internal Node Body Layout
-extern const uint32_t INTERNAL_NODE_KEY_SIZE;
 // the child is identifed by the page number
 extern const uint32_t INTERNAL_NODE_CHILD_SIZE;
+// separators have a variable length, cells only locate them in the node
+extern const uint32_t INTERNAL_NODE_KEY_OFFSET_SIZE;
+extern const uint32_t INTERNAL_NODE_KEY_LENGTH_SIZE;
 extern const uint32_t INTERNAL_NODE_CELL_SIZE;
 
+// Database Header Layout (page 0)
+extern const char DB_HEADER_MAGIC[];
+extern const uint32_t DB_HEADER_MAGIC_SIZE;
+extern const uint32_t DB_HEADER_CATALOG_ROOT_OFFSET;
+
+// Hash Index Layouts
+extern const uint32_t HASH_META_GLOBAL_DEPTH_OFFSET;
+extern const uint32_t HASH_META_NUM_DIRECTORY_PAGES_OFFSET;
+extern const uint32_t HASH_META_DIRECTORY_PAGES_OFFSET;
+extern const uint32_t HASH_META_MAX_DIRECTORY_PAGES;
+extern const uint32_t HASH_DIRECTORY_ENTRIES_OFFSET;
+extern const uint32_t HASH_DIRECTORY_ENTRIES_PER_PAGE;
+extern const uint32_t HASH_BUCKET_LOCAL_DEPTH_OFFSET;
+extern const uint32_t HASH_BUCKET_NUM_ENTRIES_OFFSET;
+extern const uint32_t HASH_BUCKET_HEADER_SIZE;
+
 // Leaf Node Header Layout
 extern const uint32_t LEAF_NODE_NUM_CELLS_SIZE;
 extern const uint32_t LEAF_NODE_NUM_CELLS_OFFSET;
 extern const uint32_t LEAF_NODE_HEADER_SIZE;
 
 // Leaf Node Body Layout
-extern const uint32_t LEAF_NODE_KEY_SIZE;
-extern const uint32_t LEAF_NODE_KEY_OFFSET;
-extern const uint32_t LEAF_NODE_VALUE_SIZE;
-extern const uint32_t LEAF_NODE_VALUE_OFFSET;
-extern const uint32_t LEAF_NODE_CELL_SIZE;
+// (the size of the cells depends on the btree, see NodeLayout)
 extern const uint32_t LEAF_NODE_SPACE_FOR_CELLS;
-extern const uint32_t LEAF_NODE_MAX_CELLS;
-extern const uint32_t LEAF_NODE_RIGHT_SPLIT_COUNT;
-extern const uint32_t LEAF_NODE_LEFT_SPLIT_COUNT;
 
 /*
   Abstraction. Represents a location in the table. Things you might want to do with cursors :
@@ -117,61 +144,70 @@ extern const uint32_t LEAF_NODE_LEFT_SPLIT_COUNT;
 */
 
 // utils
-void print_constants();
+void print_constants(Table *table);
 void indent(uint32_t level);
-void print_tree(Pager *pager, uint32_t page_num, uint32_t indentation_level);
+void print_tree(Table *table, uint32_t page_num, uint32_t indentation_level);
+void print_tree_stats(Table *table);
 
 // table functions
+Table *table_new(Pager *pager, uint32_t root_page_num, NodeLayout layout);
+void table_close(Table *table);
+NodeLayout make_node_layout(uint32_t key_size, uint32_t value_size);
+int compare_keys(Table *table, const void *a, const void *b);
+uint32_t tree_height(Table *table);
 Cursor *table_start(Table *table);
+void *cursor_key(Cursor *cursor);
 void *cursor_value(Cursor *cursor);
 void cursor_advance(Cursor *cursor);
-Cursor *table_find(Table *table, u_int32_t key_to_insert);
+Cursor *tree_find(Table *table, const void *key);
+Cursor *tree_seek(Table *table, const void *key);
 
 // leaf node utils
 uint32_t *leaf_node_num_cells(void *node);
 uint32_t *leaf_node_next_leaf(void *node);
-void *leaf_node_cell(void *node, uint32_t cell_num);
-uint32_t *leaf_node_key(void *node, uint32_t cell_num);
-void *leaf_node_value(void *node, uint32_t cell_num);
+void *leaf_node_cell(Table *table, void *node, uint32_t cell_num);
+void *leaf_node_key(Table *table, void *node, uint32_t cell_num);
+void *leaf_node_value(Table *table, void *node, uint32_t cell_num);
 void initialize_leaf_node(void *node);
+uint32_t leaf_node_used_bytes(Table *table, void *node);
 
 // internal node utils
 uint32_t *internal_node_num_keys(void *node);
 uint32_t *internal_node_rightmost_child(void *node);
-uint32_t *internal_node_cell(void *node, uint32_t cell_num);
-uint32_t *internal_node_key(void *node, uint32_t key_num);
-uint32_t *internal_node_child(void *node, uint32_t key_num);
+void *internal_node_cell(Table *table, void *node, uint32_t cell_num);
+uint32_t *internal_node_prefix_length(void *node);
+void *internal_node_prefix(void *node);
+uint16_t *internal_node_key_length(Table *table, void *node, uint32_t key_num);
+void *internal_node_key(Table *table, void *node, uint32_t key_num);
+uint32_t internal_node_separator(Table *table, void *node, uint32_t key_num, void *separator);
+uint32_t *internal_node_child(Table *table, void *node, uint32_t child_num);
+void initialize_internal_node(void *node);
 
 // node common utils
 NodeType get_node_type(void *node);
 void set_node_type(void *node, NodeType type);
 bool is_node_root(void *node);
 void set_node_root(void *node, bool is_root);
-uint32_t get_node_max_key(void *node);
+uint32_t *node_parent(void *node);
+void *get_node_max_key(Table *table, void *node);
+void *get_node_min_key(Table *table, void *node);
 
 // leaf node functions
-void leaf_node_insert(Cursor *cursor, uint32_t key, Row *value);
-void leaf_node_split_and_insert(Cursor *cursor, uint32_t key, Row *value);
-Cursor *leaf_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert);
+void leaf_node_insert(Cursor *cursor, const void *key, const void *value);
+void leaf_node_split_and_insert(Cursor *cursor, const void *key, const void *value);
+Cursor *leaf_node_find(Table *table, uint32_t page_num, const void *key);
 
 // internal node functions
-Cursor *internal_node_find(Table *table, u_int32_t page_num, u_int32_t key_to_insert);
+Cursor *internal_node_find(Table *table, uint32_t page_num, const void *key);
+void internal_node_insert(Table *table, uint32_t parent_page_num, uint32_t left_child_page_num,
+                          uint32_t new_child_page_num);
+void internal_node_split_and_insert(Table *table, uint32_t page_num, uint32_t left_child_page_num,
+                                    uint32_t new_child_page_num);
 
 // functions on nodes
 void create_new_root(Table *table, uint32_t right_child_page_num);
 
-// pager functions
-Pager *pager_open(const char *filename);
-void *get_page(Pager *pager, uint32_t page_num);
-uint32_t get_unused_page_num(Pager *pager);
-
-// common db functions
-Table *db_open(const char *filename);
-void db_close(Table *table);
-void pager_flush(Pager *pager, uint32_t page_num);
-
-// row functions
-void serialize_row(Row *source, void *destination);
-void deserialize_row(void *source, Row *destination);
+// database header functions
+uint32_t *db_header_catalog_root(void *header);
 
 #endif
\ No newline at end of file
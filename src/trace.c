@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "trace.h"
+
+// the tracer is process wide, like the tracepoints
+static TraceEvent ring[TRACE_RING_SIZE];
+static uint64_t num_events = 0;
+
+static const char *event_names[] = {"statement", "page read", "page flush", "leaf split", "internal split",
+                                    "new root"};
+static const char *argument_names[] = {"statement type", "page", "page", "page", "page", "page"};
+static const char phase_names[] = {'B', 'E', 'i'};
+
+// A clock read and a store: the oldest event is overwritten once the ring is full
+void trace_event(TraceEventType type, TracePhase phase, uint32_t argument)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    TraceEvent *event = &ring[num_events++ & (TRACE_RING_SIZE - 1)];
+    event->timestamp = (uint64_t)now.tv_sec * 1000000000ull + now.tv_nsec;
+    event->argument = argument;
+    event->type = type;
+    event->phase = phase;
+}
+
+// events recorded since the start or the last clear, including the overwritten ones
+uint64_t trace_count()
+{
+    return num_events;
+}
+
+void trace_clear()
+{
+    num_events = 0;
+}
+
+// Writes the events still in the ring, oldest first, as Chrome trace JSON (timestamps in microseconds)
+void trace_export(FILE *file)
+{
+    uint64_t first = num_events > TRACE_RING_SIZE ? num_events - TRACE_RING_SIZE : 0;
+    fprintf(file, "{\"traceEvents\": [\n");
+    for (uint64_t i = first; i < num_events; i++)
+    {
+        TraceEvent *event = &ring[i & (TRACE_RING_SIZE - 1)];
+        fprintf(file,
+                "{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": 1, \"tid\": 1, %s\"args\": {\"%s\": %u}}%s\n",
+                event_names[event->type], phase_names[event->phase], event->timestamp / 1e3,
+                event->phase == TRACE_PHASE_INSTANT ? "\"s\": \"t\", " : "", argument_names[event->type],
+                event->argument, i + 1 < num_events ? "," : "");
+    }
+    fprintf(file, "], \"displayTimeUnit\": \"ns\"}\n");
+}
@@ -0,0 +1,62 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifndef TRACE_HEADER
+#define TRACE_HEADER
+
+/*
+  Tracepoints on the pager I/O, the tree splits and the statements, compiled in with make TRACE=1.
+  Every event is a time stamp, a type and an argument (page number or statement type) written
+  into a ring buffer holding the last TRACE_RING_SIZE events: no allocation, no lock (the
+  engine is single threaded) and no I/O on the hot path. .trace <file> exports the ring as
+  Chrome trace JSON, to be opened with chrome://tracing or Perfetto.
+  Without TRACE the TRACE_* macros expand to nothing, so the tracepoints cost nothing.
+*/
+typedef enum
+{
+  TRACE_STATEMENT,      /* argument: statement type */
+  TRACE_PAGE_READ,      /* get_page miss, argument: page number */
+  TRACE_PAGE_FLUSH,     /* argument: page number */
+  TRACE_LEAF_SPLIT,     /* argument: page number of the split leaf */
+  TRACE_INTERNAL_SPLIT, /* argument: page number of the split node */
+  TRACE_NEW_ROOT        /* argument: page number of the root */
+} TraceEventType;
+
+typedef enum
+{
+  TRACE_PHASE_BEGIN,
+  TRACE_PHASE_END,
+  TRACE_PHASE_INSTANT
+} TracePhase;
+
+typedef struct
+{
+  uint64_t timestamp; /* nanoseconds, monotonic clock */
+  uint32_t argument;
+  uint8_t type;
+  uint8_t phase;
+} TraceEvent;
+
+// a power of two
+#define TRACE_RING_SIZE 65536
+
+void trace_event(TraceEventType type, TracePhase phase, uint32_t argument);
+uint64_t trace_count();
+void trace_clear();
+void trace_export(FILE *file);
+
+#ifdef TRACE
+#define TRACE_ENABLED true
+#define TRACE_BEGIN(type, argument) trace_event(type, TRACE_PHASE_BEGIN, argument)
+#define TRACE_END(type, argument) trace_event(type, TRACE_PHASE_END, argument)
+#define TRACE_INSTANT(type, argument) trace_event(type, TRACE_PHASE_INSTANT, argument)
+#else
+#define TRACE_ENABLED false
+#define TRACE_BEGIN(type, argument)
+#define TRACE_END(type, argument)
+#define TRACE_INSTANT(type, argument)
+#endif
+
+#endif
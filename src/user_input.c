@@ -14,9 +14,19 @@ InputBuffer *new_input_buffer()
 }
 
 void print_prompt() { printf("db > "); }
-void print_row(Row *row)
+// prints the given columns of the record: (value, value, ...)
+void print_record_columns(RecordLayout *layout, void *record, uint32_t *columns, uint32_t num_columns)
 {
-    printf("(%d, %s, %s)\n", row->id, row->username, row->email);
+    uint32_t length;
+    printf("(");
+    for (uint32_t i = 0; i < num_columns; i++)
+    {
+        if (i > 0)
+            printf(", ");
+        void *value = record_column(layout, record, columns[i], &length);
+        print_value(layout->columns[columns[i]].type, value, length);
+    }
+    printf(")\n");
 }
 
 void read_input(InputBuffer *input_buffer)
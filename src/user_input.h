@@ -1,6 +1,6 @@
 #include <stdlib.h>
 #include <string.h>
-#include "table.h"
+#include "record.h"
 
 #ifndef USER_INPUT_HEADER
 #define USER_INPUT_HEADER
@@ -14,7 +14,7 @@ typedef struct
 
 InputBuffer *new_input_buffer();
 void print_prompt();
-void print_row(Row *row);
+void print_record_columns(RecordLayout *layout, void *record, uint32_t *columns, uint32_t num_columns);
 void read_input(InputBuffer *input_buffer);
 void close_input_buffer(InputBuffer *input_buffer);
 
@@ -0,0 +1,437 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include "vfs.h"
+
+// posix: the file descriptor does the whole job
+
+typedef struct
+{
+    VfsFile base;
+    int file_descriptor;
+} PosixFile;
+
+static int open_file_descriptor(const char *path)
+{
+    return open(path,
+                O_RDWR |     // Read/Write mode
+                    O_CREAT, // Create file if it does not exist
+                S_IWUSR |    // User write permission
+                    S_IRUSR  // User read permission
+    );
+}
+
+static ssize_t posix_read_at(VfsFile *file, uint64_t offset, void *buffer, uint32_t size)
+{
+    return pread(((PosixFile *)file)->file_descriptor, buffer, size, offset);
+}
+
+static ssize_t posix_write_at(VfsFile *file, uint64_t offset, const void *buffer, uint32_t size)
+{
+    return pwrite(((PosixFile *)file)->file_descriptor, buffer, size, offset);
+}
+
+static int posix_sync(VfsFile *file)
+{
+    return fsync(((PosixFile *)file)->file_descriptor);
+}
+
+static int posix_truncate(VfsFile *file, uint64_t size)
+{
+    return ftruncate(((PosixFile *)file)->file_descriptor, size);
+}
+
+static int64_t posix_size(VfsFile *file)
+{
+    return lseek(((PosixFile *)file)->file_descriptor, 0, SEEK_END);
+}
+
+static int posix_lock(VfsFile *file)
+{
+    return flock(((PosixFile *)file)->file_descriptor, LOCK_EX | LOCK_NB);
+}
+
+static void posix_prefetch(VfsFile *file, uint64_t offset, uint32_t size)
+{
+    posix_fadvise(((PosixFile *)file)->file_descriptor, offset, size, POSIX_FADV_WILLNEED);
+}
+
+static int posix_close(VfsFile *file)
+{
+    int result = close(((PosixFile *)file)->file_descriptor);
+    free(file);
+    return result;
+}
+
+static const VfsMethods posix_methods = {posix_read_at, posix_write_at, posix_sync, posix_truncate,
+                                         posix_size,    posix_lock,     posix_prefetch, posix_close};
+
+static VfsFile *posix_open(Vfs *vfs, const char *path)
+{
+    int fd = open_file_descriptor(path);
+    if (fd == -1)
+        return NULL;
+    PosixFile *file = malloc(sizeof(PosixFile));
+    file->base.methods = &posix_methods;
+    file->file_descriptor = fd;
+    return &(file->base);
+}
+
+/*
+  mmap: the file is mapped shared, a read or a write is a memcpy.
+  Touching a mapping past the end of its file is a SIGBUS, so the file is extended ahead of the
+  writes by MMAP_GROWTH bytes at a time and mapped again, and cut back to its real size on close.
+*/
+
+#define MMAP_GROWTH (1 << 20)
+
+typedef struct
+{
+    VfsFile base;
+    int file_descriptor;
+    uint8_t *map;
+    uint64_t size;        /* of the data, the file is bigger while it is open */
+    uint64_t mapped_size; /* of the file and of the mapping */
+} MmapFile;
+
+static int mmap_remap(MmapFile *file, uint64_t mapped_size)
+{
+    if (file->map != NULL)
+        munmap(file->map, file->mapped_size);
+    file->map = NULL;
+    file->mapped_size = mapped_size;
+    if (mapped_size == 0)
+        return 0;
+    void *map = mmap(NULL, mapped_size, PROT_READ | PROT_WRITE, MAP_SHARED, file->file_descriptor, 0);
+    if (map == MAP_FAILED)
+        return -1;
+    file->map = map;
+    return 0;
+}
+
+static ssize_t mmap_read_at(VfsFile *vfs_file, uint64_t offset, void *buffer, uint32_t size)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    if (offset >= file->size)
+        return 0;
+    if (offset + size > file->size)
+        size = file->size - offset;
+    memcpy(buffer, file->map + offset, size);
+    return size;
+}
+
+static ssize_t mmap_write_at(VfsFile *vfs_file, uint64_t offset, const void *buffer, uint32_t size)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    if (offset + size > file->mapped_size)
+    {
+        uint64_t mapped_size = (offset + size + MMAP_GROWTH - 1) / MMAP_GROWTH * MMAP_GROWTH;
+        if (ftruncate(file->file_descriptor, mapped_size) == -1 || mmap_remap(file, mapped_size) == -1)
+            return -1;
+    }
+    memcpy(file->map + offset, buffer, size);
+    if (offset + size > file->size)
+        file->size = offset + size;
+    return size;
+}
+
+static int mmap_sync(VfsFile *vfs_file)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    return file->map == NULL ? 0 : msync(file->map, file->mapped_size, MS_SYNC);
+}
+
+static int mmap_truncate(VfsFile *vfs_file, uint64_t size)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    if (size > file->mapped_size)
+    {
+        // the new bytes are zeros, like with ftruncate
+        uint8_t zero = 0;
+        if (mmap_write_at(vfs_file, size - 1, &zero, 1) == -1)
+            return -1;
+    }
+    else if (size > file->size)
+        memset(file->map + file->size, 0, size - file->size);
+    file->size = size;
+    return 0;
+}
+
+static int64_t mmap_size(VfsFile *file)
+{
+    return ((MmapFile *)file)->size;
+}
+
+static int mmap_lock(VfsFile *file)
+{
+    return flock(((MmapFile *)file)->file_descriptor, LOCK_EX | LOCK_NB);
+}
+
+static void mmap_prefetch(VfsFile *vfs_file, uint64_t offset, uint32_t size)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    // madvise wants an address aligned on a page of the system
+    uint64_t system_page_size = sysconf(_SC_PAGESIZE);
+    uint64_t start = offset / system_page_size * system_page_size;
+    if (offset + size <= file->size)
+        madvise(file->map + start, offset + size - start, MADV_WILLNEED);
+}
+
+static int mmap_close(VfsFile *vfs_file)
+{
+    MmapFile *file = (MmapFile *)vfs_file;
+    int result = mmap_remap(file, 0);
+    if (ftruncate(file->file_descriptor, file->size) == -1)
+        result = -1;
+    if (close(file->file_descriptor) == -1)
+        result = -1;
+    free(file);
+    return result;
+}
+
+static const VfsMethods mmap_methods = {mmap_read_at, mmap_write_at, mmap_sync,     mmap_truncate,
+                                        mmap_size,    mmap_lock,     mmap_prefetch, mmap_close};
+
+static VfsFile *mmap_open(Vfs *vfs, const char *path)
+{
+    int fd = open_file_descriptor(path);
+    if (fd == -1)
+        return NULL;
+    MmapFile *file = malloc(sizeof(MmapFile));
+    file->base.methods = &mmap_methods;
+    file->file_descriptor = fd;
+    file->map = NULL;
+    file->size = lseek(fd, 0, SEEK_END);
+    if (mmap_remap(file, file->size) == -1)
+    {
+        close(fd);
+        free(file);
+        return NULL;
+    }
+    return &(file->base);
+}
+
+// memory: a buffer doubling as it fills, gone when the file is closed
+
+typedef struct
+{
+    VfsFile base;
+    uint8_t *data;
+    uint64_t size;
+    uint64_t capacity;
+} MemoryFile;
+
+static ssize_t memory_read_at(VfsFile *vfs_file, uint64_t offset, void *buffer, uint32_t size)
+{
+    MemoryFile *file = (MemoryFile *)vfs_file;
+    if (offset >= file->size)
+        return 0;
+    if (offset + size > file->size)
+        size = file->size - offset;
+    memcpy(buffer, file->data + offset, size);
+    return size;
+}
+
+static int memory_truncate(VfsFile *vfs_file, uint64_t size)
+{
+    MemoryFile *file = (MemoryFile *)vfs_file;
+    if (size > file->capacity)
+    {
+        uint64_t capacity = file->capacity == 0 ? MMAP_GROWTH : file->capacity;
+        while (capacity < size)
+            capacity *= 2;
+        uint8_t *data = realloc(file->data, capacity);
+        if (data == NULL)
+            return -1;
+        file->data = data;
+        file->capacity = capacity;
+    }
+    if (size > file->size)
+        memset(file->data + file->size, 0, size - file->size);
+    file->size = size;
+    return 0;
+}
+
+static ssize_t memory_write_at(VfsFile *vfs_file, uint64_t offset, const void *buffer, uint32_t size)
+{
+    MemoryFile *file = (MemoryFile *)vfs_file;
+    if (offset + size > file->size && memory_truncate(vfs_file, offset + size) == -1)
+        return -1;
+    memcpy(file->data + offset, buffer, size);
+    return size;
+}
+
+static int memory_sync(VfsFile *file)
+{
+    return 0;
+}
+
+static int64_t memory_size(VfsFile *file)
+{
+    return ((MemoryFile *)file)->size;
+}
+
+static int memory_lock(VfsFile *file)
+{
+    return 0;
+}
+
+static void memory_prefetch(VfsFile *file, uint64_t offset, uint32_t size)
+{
+}
+
+static int memory_close(VfsFile *file)
+{
+    free(((MemoryFile *)file)->data);
+    free(file);
+    return 0;
+}
+
+static const VfsMethods memory_methods = {memory_read_at, memory_write_at, memory_sync,     memory_truncate,
+                                          memory_size,    memory_lock,     memory_prefetch, memory_close};
+
+static VfsFile *memory_open(Vfs *vfs, const char *path)
+{
+    MemoryFile *file = calloc(1, sizeof(MemoryFile));
+    file->base.methods = &memory_methods;
+    return &(file->base);
+}
+
+// latency: sleeps, then forwards to the file of the wrapped VFS
+
+typedef struct
+{
+    Vfs base;
+    Vfs *wrapped;
+    char name[32]; /* latency(<name of the wrapped VFS>) */
+    uint64_t read_ns;
+    uint64_t write_ns;
+    uint64_t sync_ns;
+} LatencyVfs;
+
+typedef struct
+{
+    VfsFile base;
+    VfsFile *wrapped;
+    LatencyVfs *vfs;
+} LatencyFile;
+
+static void sleep_ns(uint64_t ns)
+{
+    if (ns == 0)
+        return;
+    struct timespec duration = {ns / 1000000000, ns % 1000000000};
+    nanosleep(&duration, NULL);
+}
+
+static ssize_t latency_read_at(VfsFile *vfs_file, uint64_t offset, void *buffer, uint32_t size)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    sleep_ns(file->vfs->read_ns);
+    return file->wrapped->methods->read_at(file->wrapped, offset, buffer, size);
+}
+
+static ssize_t latency_write_at(VfsFile *vfs_file, uint64_t offset, const void *buffer, uint32_t size)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    sleep_ns(file->vfs->write_ns);
+    return file->wrapped->methods->write_at(file->wrapped, offset, buffer, size);
+}
+
+static int latency_sync(VfsFile *vfs_file)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    sleep_ns(file->vfs->sync_ns);
+    return file->wrapped->methods->sync(file->wrapped);
+}
+
+static int latency_truncate(VfsFile *vfs_file, uint64_t size)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    return file->wrapped->methods->truncate(file->wrapped, size);
+}
+
+static int64_t latency_size(VfsFile *vfs_file)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    return file->wrapped->methods->size(file->wrapped);
+}
+
+static int latency_lock(VfsFile *vfs_file)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    return file->wrapped->methods->lock(file->wrapped);
+}
+
+static void latency_prefetch(VfsFile *vfs_file, uint64_t offset, uint32_t size)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    file->wrapped->methods->prefetch(file->wrapped, offset, size);
+}
+
+static int latency_close(VfsFile *vfs_file)
+{
+    LatencyFile *file = (LatencyFile *)vfs_file;
+    int result = file->wrapped->methods->close(file->wrapped);
+    free(file);
+    return result;
+}
+
+static const VfsMethods latency_methods = {latency_read_at, latency_write_at, latency_sync,     latency_truncate,
+                                           latency_size,    latency_lock,     latency_prefetch, latency_close};
+
+static VfsFile *latency_open(Vfs *vfs, const char *path)
+{
+    LatencyVfs *latency_vfs = (LatencyVfs *)vfs;
+    VfsFile *wrapped = latency_vfs->wrapped->open(latency_vfs->wrapped, path);
+    if (wrapped == NULL)
+        return NULL;
+    LatencyFile *file = malloc(sizeof(LatencyFile));
+    file->base.methods = &latency_methods;
+    file->wrapped = wrapped;
+    file->vfs = latency_vfs;
+    return &(file->base);
+}
+
+// Wraps a VFS so that every read, write and sync of its files first sleeps for the given time.
+// The wrapper is named latency(<base>) and lives as long as the process.
+Vfs *vfs_latency(Vfs *base, uint64_t read_ns, uint64_t write_ns, uint64_t sync_ns)
+{
+    LatencyVfs *vfs = malloc(sizeof(LatencyVfs));
+    snprintf(vfs->name, sizeof(vfs->name), "latency(%s)", base->name);
+    vfs->base.name = vfs->name;
+    vfs->base.open = latency_open;
+    vfs->wrapped = base;
+    vfs->read_ns = read_ns;
+    vfs->write_ns = write_ns;
+    vfs->sync_ns = sync_ns;
+    return &(vfs->base);
+}
+
+static Vfs vfs_list[] = {{"posix", posix_open}, {"mmap", mmap_open}, {"memory", memory_open}};
+static Vfs *default_vfs = &vfs_list[0];
+
+Vfs *vfs_find(const char *name)
+{
+    for (uint32_t i = 0; i < sizeof(vfs_list) / sizeof(Vfs); i++)
+        if (strcmp(vfs_list[i].name, name) == 0)
+            return &vfs_list[i];
+    return NULL;
+}
+
+// The VFS used by pager_open
+Vfs *vfs_default()
+{
+    return default_vfs;
+}
+
+void vfs_set_default(Vfs *vfs)
+{
+    default_vfs = vfs;
+}
@@ -0,0 +1,56 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifndef VFS_HEADER
+#define VFS_HEADER
+
+/*
+  The pager reaches its file through a VFS, so that the way the bytes are stored can change
+  without touching it. Available (--vfs <name>):
+  • posix: pread / pwrite on a file descriptor, the default
+  • mmap: the file is mapped in memory, reads and writes are copies from and to the mapping
+  • memory: a buffer that lives as long as the file is open, nothing is written to disk
+  Any of them can be wrapped by vfs_latency, which sleeps before every read, write and sync
+  to simulate a slow disk (--io-latency <microseconds>).
+  A VFS opens files, and every open file carries the methods that work on it.
+*/
+typedef struct VfsFile VfsFile;
+
+typedef struct
+{
+  // bytes read, fewer at the end of the file, -1 on error
+  ssize_t (*read_at)(VfsFile *file, uint64_t offset, void *buffer, uint32_t size);
+  // bytes written, the file grows as needed, -1 on error
+  ssize_t (*write_at)(VfsFile *file, uint64_t offset, const void *buffer, uint32_t size);
+  // 0 once the data written is durable, -1 on error
+  int (*sync)(VfsFile *file);
+  int (*truncate)(VfsFile *file, uint64_t size);
+  int64_t (*size)(VfsFile *file);
+  // exclusive lock for the process, -1 if another one holds it
+  int (*lock)(VfsFile *file);
+  // hint that a range will be read soon
+  void (*prefetch)(VfsFile *file, uint64_t offset, uint32_t size);
+  // releases the lock and frees the file, -1 on error
+  int (*close)(VfsFile *file);
+} VfsMethods;
+
+struct VfsFile
+{
+  const VfsMethods *methods;
+};
+
+typedef struct Vfs
+{
+  const char *name;
+  // opens the file, creating it if it doesn't exist, NULL on error
+  VfsFile *(*open)(struct Vfs *vfs, const char *path);
+} Vfs;
+
+Vfs *vfs_find(const char *name);
+Vfs *vfs_default();
+void vfs_set_default(Vfs *vfs);
+Vfs *vfs_latency(Vfs *base, uint64_t read_ns, uint64_t write_ns, uint64_t sync_ns);
+
+#endif